@@ -0,0 +1,470 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ncurses.h>
+
+#include "engine.h"
+#include "screen.h"
+#include "solver.h"
+
+// benchmarks of the engine and the screen, run with: make bench
+// every size is a synthetic dictionary of that many lines (always the
+// same ones), the results are printed as json on the standard output
+
+// order in which the characters are guessed
+#define FREQUENCIES "etaoinshrdlcumwfgypbvkjxqz"
+// frames rendered and matches solved for each size
+#define FRAMES 2000
+// rounds of guesses timed on each started match
+#define ROUNDS 4
+// longest line of the synthetic dictionaries
+#define LINE_SIZE 256
+
+// declaration of the functions used by the benchmarks
+char *synthetic_dictionary(long lines);
+int synthetic_line(char *line, unsigned long long *rng);
+vector_string *bench_load(const char *path, long lines);
+void bench_clean(const char *path, long lines);
+void bench_hidden(vector_string *puzzle, long lines);
+void bench_find(vector_string *puzzle, long lines);
+void bench_start(vector_string *puzzle, long lines);
+void bench_render(vector_string *puzzle, long lines);
+void bench_solver(vector_string *puzzle, long lines);
+void report(const char *name, long lines, long operations, double seconds);
+double elapsed(struct timespec *begin);
+// the cleaning used before the single pass one, kept to compare them
+int clean_for_print_reference(char *string, int size);
+
+// results already printed (they are separated by commas)
+int reported;
+
+// the main function of the benchmarks
+int main(int argc, char const *argv[])
+{
+	long sizes[argc];
+	int count = 0;
+	for (int index = 1; index < argc; ++index)
+		if ((sizes[count++] = atol(argv[index])) <= 0)
+		{
+			fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman-bench [<lines-1> ...]\n\n");
+			return FAILURE;
+		}
+	if (!count)
+	{
+		sizes[count++] = 1000;
+		sizes[count++] = 100000;
+	}
+
+	printf("{\n  \"benchmarks\": [");
+	for (int index = 0; index < count; ++index)
+	{
+		char *path = synthetic_dictionary(sizes[index]);
+
+		vector_string *puzzle = bench_load(path, sizes[index]);
+		bench_clean(path, sizes[index]);
+		bench_hidden(puzzle, sizes[index]);
+		bench_find(puzzle, sizes[index]);
+		bench_start(puzzle, sizes[index]);
+		bench_render(puzzle, sizes[index]);
+		bench_solver(puzzle, sizes[index]);
+
+		database_destroy(puzzle);
+		unlink(path);
+		free(path);
+	}
+	printf("\n  ]\n}\n");
+	return SUCCESS;
+}
+
+// write a dictionary of lines in a temporary file, returns its path
+char *synthetic_dictionary(long lines)
+{
+	const char *directory = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+	char *path = (char *) malloc(strlen(directory) + 32);
+	if (!path)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	sprintf(path, "%s/hangman-bench-XXXXXX", directory);
+
+	int descriptor = mkstemp(path);
+	FILE *out = descriptor < 0 ? NULL : fdopen(descriptor, "w");
+	if (!out)
+	{
+		fprintf(stderr, "[Error] File %s failed to open\n\n", path);
+		exit(FAILURE);
+	}
+
+	// the same seed for every size, so a size always gives the same file
+	unsigned long long rng = 1;
+	char line[LINE_SIZE];
+	for (long index = 0; index < lines; ++index)
+		fwrite(line, 1, synthetic_line(line, &rng), out);
+
+	if (fclose(out))
+	{
+		fprintf(stderr, "[Error] Could not write the file %s\n\n", path);
+		exit(FAILURE);
+	}
+	return path;
+}
+
+// a line of a dictionary: mostly words, some expressions, with capital
+// letters, spaces, tabs and bytes that are not printable inside them;
+// returns its size (the new line included)
+int synthetic_line(char *line, unsigned long long *rng)
+{
+	const char noise[] = "  \t\r\x01\xC8\xA3-'.";
+	int words = random_next(rng) % 4 ? 1 : 2 + random_next(rng) % 5;
+	int size = 0;
+
+	for (int word = 0; word < words; ++word)
+	{
+		if (word)
+			line[size++] = ' ';
+
+		// the noise is never first or last, so the old and the new
+		// cleaning must give the same lines
+		int letters = (words > 1 ? 1 : 3) + random_next(rng) % 10;
+		for (int index = 0; index < letters; ++index)
+		{
+			unsigned int value = random_next(rng);
+			if (index && value % 16 == 0)
+				line[size++] = noise[value / 16 % (sizeof(noise) - 1)];
+			line[size++] = (value % 8 == 1 ? 'A' : 'a') + value / 256 % 26;
+		}
+	}
+	line[size++] = '\n';
+	return size;
+}
+
+// store the dictionary in a new database
+vector_string *bench_load(const char *path, long lines)
+{
+	int in = open(path, O_RDONLY);
+	if (in < 0)
+	{
+		fprintf(stderr, "[Error] File %s failed to open\n\n", path);
+		exit(FAILURE);
+	}
+
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	vector_string *puzzle = database_create();
+	if (database_store(in, puzzle) != SUCCESS)
+	{
+		fprintf(stderr, "[Error] Could not parse the file %s\n\n", path);
+		exit(FAILURE);
+	}
+	report("load", lines, lines, elapsed(&begin));
+
+	close(in);
+	return puzzle;
+}
+
+// clean every line of the dictionary with both implementations; the
+// lines are copied in a buffer first, as the loader does
+void bench_clean(const char *path, long lines)
+{
+	int in = open(path, O_RDONLY);
+	struct stat info;
+	if (in < 0 || fstat(in, &info) < 0)
+	{
+		fprintf(stderr, "[Error] File %s failed to open\n\n", path);
+		exit(FAILURE);
+	}
+	char *file = (char *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, in, 0);
+	if (file == MAP_FAILED)
+	{
+		fprintf(stderr, "[Error] Could not parse the file %s\n\n", path);
+		exit(FAILURE);
+	}
+	close(in);
+
+	char reference[LINE_SIZE], current[LINE_SIZE];
+	char *end = file + info.st_size;
+	struct timespec begin;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (char *line = file, *eol; line < end; line = eol)
+	{
+		eol = (char *) memchr(line, '\n', end - line) + 1;
+		memcpy(reference, line, eol - line);
+		clean_for_print_reference(reference, eol - line);
+	}
+	report("clean_reference", lines, lines, elapsed(&begin));
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (char *line = file, *eol; line < end; line = eol)
+	{
+		eol = (char *) memchr(line, '\n', end - line) + 1;
+		memcpy(current, line, eol - line);
+		clean_for_print(current, eol - line, NULL);
+	}
+	report("clean", lines, lines, elapsed(&begin));
+
+	// both of them have to give the same lines (not timed)
+	for (char *line = file, *eol; line < end; line = eol)
+	{
+		eol = (char *) memchr(line, '\n', end - line) + 1;
+		memcpy(reference, line, eol - line);
+		memcpy(current, line, eol - line);
+		int size = clean_for_print_reference(reference, eol - line);
+		if (clean_for_print(current, eol - line, NULL) != size || memcmp(reference, current, size))
+		{
+			fprintf(stderr, "[Error] The cleaning of \"%.*s\" changed\n\n", (int) (eol - line - 1), line);
+			exit(FAILURE);
+		}
+	}
+	munmap(file, info.st_size);
+}
+
+// start a match with every expression: the position lists and the
+// hidden string are made for each one
+void bench_hidden(vector_string *puzzle, long lines)
+{
+	data *game = game_create();
+	struct timespec begin;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int index = 0; index < puzzle->count; ++index)
+		start_expression(game, puzzle, index);
+	report("hidden", lines, puzzle->count, elapsed(&begin));
+
+	game_destroy(game);
+}
+
+// try every letter in every expression, ROUNDS times: each match is
+// started before the clock runs, and what the guesses change (the hidden
+// string and the charsets) is copied back before each round, so only
+// the guesses and the copy are timed
+void bench_find(vector_string *puzzle, long lines)
+{
+	data *game = game_create();
+	char *hidden = NULL;
+	int capacity = 0;
+	double seconds = 0;
+
+	for (int index = 0; index < puzzle->count; ++index)
+	{
+		start_expression(game, puzzle, index);
+		int size = puzzle->entries[index].size + 1;
+		if (size > capacity)
+		{
+			capacity = game->length;
+			hidden = (char *) realloc(hidden, capacity);
+			if (!hidden)
+			{
+				fprintf(stderr, "[Error] Not enough memory.\n");
+				exit(FAILURE);
+			}
+		}
+		memcpy(hidden, game->hidden, size);
+		charset secret = game->secret, shown = game->shown, tried = game->tried;
+
+		struct timespec begin;
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		for (int round = 0; round < ROUNDS; ++round)
+		{
+			memcpy(game->hidden, hidden, size);
+			game->secret = secret;
+			game->shown = shown;
+			game->tried = tried;
+			for (const char *ch = FREQUENCIES; *ch; ++ch)
+				find_character(game, *ch);
+		}
+		seconds += elapsed(&begin);
+	}
+	report("find_character", lines, (long) puzzle->count * ROUNDS * (sizeof(FREQUENCIES) - 1), seconds);
+
+	free(hidden);
+	game_destroy(game);
+}
+
+// draw every expression from the pool, the time of each tenth of them
+// shows if the selection slows down while the pool drains
+void bench_start(vector_string *puzzle, long lines)
+{
+	data *game = game_create();
+	game->seed = 1;
+	database_reset(puzzle);
+
+	char name[32];
+	struct timespec begin;
+	for (int decile = 0; decile < 10; ++decile)
+	{
+		long draws = puzzle->count * (decile + 1L) / 10 - puzzle->count * (long) decile / 10;
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		for (long draw = 0; draw < draws; ++draw)
+			start(game, puzzle);
+		sprintf(name, "start_decile_%d", decile + 1);
+		report(name, lines, draws, elapsed(&begin));
+	}
+
+	// the same from a few buckets: single words of 5 to 8 characters
+	selection filter = {{5, 8}, {1, 1}, {0, 0}};
+	database_reset(puzzle);
+	long draws = 0;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	while (start_selection(game, puzzle, &filter) == SUCCESS)
+		draws++;
+	report("start_selection", lines, draws, elapsed(&begin));
+
+	database_reset(puzzle);
+	game_destroy(game);
+}
+
+// print whole frames and frames after a guess on a screen that is not
+// shown anywhere
+void bench_render(vector_string *puzzle, long lines)
+{
+	FILE *out = fopen("/dev/null", "w");
+	FILE *in = fopen("/dev/null", "r");
+	SCREEN *screen = out && in ? newterm("xterm", out, in) : NULL;
+	if (!screen)
+	{
+		fprintf(stderr, "[Error] Could not create a virtual screen\n\n");
+		exit(FAILURE);
+	}
+	resize_term(FULL_ROWS, FULL_COLS);
+	place_screens();
+	WINDOW *win = newwin(LINES, COLS, 0, 0);
+	start_color();
+	declare_colors();
+	cache_screen(SCREEN_GAME, print_new_game);
+
+	data *game = game_create();
+	frame drawn;
+	struct timespec begin;
+
+	// a new match on a clean screen, everything is printed and sent
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int index = 0; index < FRAMES; ++index)
+	{
+		start_expression(game, puzzle, index % puzzle->count);
+		show_screen(win, SCREEN_GAME);
+		drawn = (frame) {-1, -1, ""};
+		print_match(win, game, puzzle, &drawn);
+		clearok(win, TRUE);
+		wnoutrefresh(win);
+		doupdate();
+	}
+	report("render_full", lines, FRAMES, elapsed(&begin));
+
+	// a guess in a match already on the screen
+	int expression = 0;
+	const char *ch = FREQUENCIES;
+	start_expression(game, puzzle, expression);
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int index = 0; index < FRAMES; ++index)
+	{
+		if (game_status(game) != RUNNING || !*ch)
+		{
+			start_expression(game, puzzle, ++expression % puzzle->count);
+			ch = FREQUENCIES;
+		}
+		guess_character(game, *ch++);
+		print_match(win, game, puzzle, &drawn);
+		wnoutrefresh(win);
+		doupdate();
+	}
+	report("render_guess", lines, FRAMES, elapsed(&begin));
+
+	// the table of a match printed again, and copied from its pad
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int index = 0; index < FRAMES; ++index)
+	{
+		werase(win);
+		print_new_game(win);
+	}
+	report("screen_print", lines, FRAMES, elapsed(&begin));
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int index = 0; index < FRAMES; ++index)
+		show_screen(win, SCREEN_GAME);
+	report("screen_copy", lines, FRAMES, elapsed(&begin));
+
+	game_destroy(game);
+	delwin(win);
+	free_screens();
+	endwin();
+	delscreen(screen);
+	fclose(out);
+	fclose(in);
+}
+
+// index the expressions by shape and let the solver play matches; the
+// time of a guess is the time of the matches over the guesses made
+void bench_solver(vector_string *puzzle, long lines)
+{
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	solver_index *index = solver_create(puzzle);
+	report("solver_index", lines, puzzle->count, elapsed(&begin));
+
+	data *game = game_create();
+	solver_state *state = solver_state_create(index);
+	long guesses = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (int match = 0; match < FRAMES; ++match)
+	{
+		start_expression(game, puzzle, (long) match * puzzle->count / FRAMES);
+		while (game_status(game) == RUNNING)
+		{
+			int ch = solver_guess(state, game);
+			if (ch < 0)
+				break;
+			guess_character(game, ch);
+			guesses++;
+		}
+	}
+	report("solver_guess", lines, guesses, elapsed(&begin));
+
+	solver_state_destroy(state);
+	game_destroy(game);
+	solver_destroy(index);
+}
+
+// print the result of a benchmark
+void report(const char *name, long lines, long operations, double seconds)
+{
+	printf("%s\n    {\"name\": \"%s\", \"lines\": %ld, \"operations\": %ld, \"seconds\": %.6f, "
+		"\"ns_per_op\": %.2f, \"ops_per_sec\": %.0f}",
+		reported++ ? "," : "", name, lines, operations, seconds,
+		operations ? seconds * 1e9 / operations : 0, seconds > 0 ? operations / seconds : 0);
+	fflush(stdout);
+}
+
+// seconds passed since begin
+double elapsed(struct timespec *begin)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) + (now.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+// the old cleaning, one memmove for each character removed
+int clean_for_print_reference(char *string, int size)
+{
+	for (int index = 0; index < size; ++index)
+	{
+		if (!isprint((unsigned char) string[index]) ||
+			(index > 1 && isspace(string[index - 1]) && isspace(string[index])))
+		{
+			memmove(string + index, string + index + 1, size - index);
+			--index;
+			--size;
+			continue;
+		}
+		if (isupper((unsigned char) string[index]))
+			string[index]= tolower(string[index]);
+	}
+	return size;
+}
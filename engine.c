@@ -0,0 +1,1925 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "engine.h"
+#include "probe.h"
+
+// what clean_for_print keeps of each character: 0 for the characters
+// that are not printable, lowercase for the letters, the rest as it is
+#define CLEAN(c) ((c) >= 'A' && (c) <= 'Z' ? (c) - 'A' + 'a' : (c) >= ' ' && (c) < 0x7F ? (c) : 0)
+#define CLEAN4(c) CLEAN(c), CLEAN(c + 1), CLEAN(c + 2), CLEAN(c + 3)
+#define CLEAN16(c) CLEAN4(c), CLEAN4(c + 4), CLEAN4(c + 8), CLEAN4(c + 12)
+#define CLEAN64(c) CLEAN16(c), CLEAN16(c + 16), CLEAN16(c + 32), CLEAN16(c + 48)
+
+static const unsigned char clean_table[256] = {
+	CLEAN64(0), CLEAN64(64), CLEAN64(128), CLEAN64(192)
+};
+
+// ranges of capital letters that are not ascii (latin, romanian, greek
+// and cyrillic): the first and the last one, how far their small letters
+// are and 2 if only every other character is a capital letter
+static const int cases[][4] = {
+	{0xC0, 0xD6, 32, 1}, {0xD8, 0xDE, 32, 1}, {0x100, 0x12E, 1, 2}, {0x132, 0x136, 1, 2},
+	{0x139, 0x147, 1, 2}, {0x14A, 0x176, 1, 2}, {0x178, 0x178, 0xFF - 0x178, 1}, {0x179, 0x17D, 1, 2},
+	{0x200, 0x21E, 1, 2}, {0x222, 0x232, 1, 2}, {0x386, 0x386, 38, 1}, {0x388, 0x38A, 37, 1},
+	{0x38C, 0x38C, 64, 1}, {0x38E, 0x38F, 63, 1}, {0x391, 0x3A1, 32, 1}, {0x3A3, 0x3AB, 32, 1},
+	{0x400, 0x40F, 80, 1}, {0x410, 0x42F, 32, 1}
+};
+
+// ranges of code points that do not take one column on a terminal: the
+// control characters, the marks printed over another character and the
+// other invisible ones take none (they are left out), the chinese,
+// japanese and korean characters take two
+static const int widths[][3] = {
+	{0x80, 0x9F, 0}, {0x300, 0x36F, 0}, {0x483, 0x489, 0}, {0x1100, 0x115F, 2},
+	{0x1AB0, 0x1AFF, 0}, {0x1DC0, 0x1DFF, 0}, {0x200B, 0x200F, 0}, {0x2028, 0x202E, 0},
+	{0x2060, 0x206F, 0}, {0x20D0, 0x20FF, 0}, {0x2E80, 0x303E, 2}, {0x3041, 0xA4CF, 2},
+	{0xAC00, 0xD7A3, 2}, {0xD800, 0xDFFF, 0}, {0xF900, 0xFAFF, 2}, {0xFE00, 0xFE0F, 0},
+	{0xFE20, 0xFE2F, 0}, {0xFE30, 0xFE4F, 2}, {0xFEFF, 0xFEFF, 0}, {0xFF00, 0xFF60, 2},
+	{0xFFE0, 0xFFE6, 2}, {0xFFF0, 0xFFFF, 0}, {0x1F300, 0x1F64F, 2}, {0x1F900, 0x1F9FF, 2},
+	{0x20000, 0x3FFFD, 2}, {0xE0000, 0xE0FFF, 0}
+};
+
+// the pool and the buckets are changed with the lock of the database held
+static void dimensions_of(const entry *expression, int values[3]);
+static int bucket_of(const entry *expression);
+static void bucket_add(vector_string *vec, int index);
+static void bucket_grow(bucket *current);
+static void pool_remove(vector_string *vec, int index);
+static void played_reserve(vector_string *vec, int count);
+static int selection_bounds(const selection *filter, int which, int limit, int *low, int *high, bool *partial);
+static bool selection_fits(const vector_string *vec, const selection *filter, int index);
+static void selection_prepare(vector_string *vec, const selection *filter);
+static void selection_update(vector_string *vec, int which, int index, int change);
+static int selection_count(vector_string *vec, const selection *filter);
+static int selection_draw(vector_string *vec, const selection *filter, unsigned int random);
+static bool database_packed(int source);
+static void database_unindex(vector_string *vec);
+static bool pack_fits(const pack_header *header, size_t size);
+static void *parse_files(void *argument);
+static void glyph_insert(alphabet *glyphs, int code, int ch);
+static int glyph_character(alphabet *glyphs, int code);
+static bool glyph_fits(const alphabet *glyphs, const char *text, size_t size);
+static bool glyph_union(const alphabet *glyphs, const alphabet *other);
+static bool glyph_space(int code);
+static bool glyph_tried(const data *game, int code);
+
+// allocate the data of a game, no match is started yet
+data *game_create()
+{
+	data *game = (data *) calloc(1, sizeof(data));
+	if (!game)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+
+	game->index = -1;
+	game->score = 0;
+	game->stage = 0;
+	game->length = STRING_SIZE;
+	game->string   = (char *) calloc(STRING_SIZE, sizeof(char));
+	game->hidden   = (char *) calloc(STRING_SIZE, sizeof(char));
+	game->mistakes = (char *) calloc(MISTAKES_SIZE, sizeof(char));
+	game->next     = (int *) calloc(STRING_SIZE, sizeof(int));
+	if (!game->string || !game->hidden || !game->mistakes || !game->next)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 5);
+	PROBE_COUNT(COUNTER_ALLOCATED, sizeof(data) + MISTAKES_SIZE + STRING_SIZE * (2 + sizeof(int)));
+	return game;
+}
+
+// make the buffers of the game hold an expression of size characters;
+// they only grow, so after the longest expression the rounds do not
+// allocate anything
+void game_reserve(data *game, int size)
+{
+	if (size < game->length)
+		return;
+
+	int length = game->length;
+	while (length <= size)
+		length *= 2;
+
+	char *saux = (char *) realloc(game->string, length);
+	if (saux)
+		game->string = saux;
+	char *haux = (char *) realloc(game->hidden, length);
+	if (haux)
+		game->hidden = haux;
+	int *naux = (int *) realloc(game->next, sizeof(int) * length);
+	if (naux)
+		game->next = naux;
+	// Heap Memory is full
+	if (!saux || !haux || !naux)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 3);
+	PROBE_COUNT(COUNTER_ALLOCATED, length * (2 + sizeof(int)));
+	game->length = length;
+}
+
+void game_destroy(data *game)
+{
+	free(game->mistakes);
+	free(game->hidden);
+	free(game->string);
+	free(game->next);
+	free(game);
+}
+
+// allocate an empty word | expression database
+vector_string *database_create()
+{
+	vector_string *puzzle = (vector_string *) calloc(1, sizeof(vector_string));
+	if (!puzzle)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+
+	puzzle->buckets = (bucket *) calloc(BUCKETS, sizeof(bucket));
+	if (!puzzle->buckets)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+
+	puzzle->dim = 20;
+	puzzle->resumed = -1;
+	puzzle->chars = 0;
+	puzzle->count = 0;
+	puzzle->exprs = 0;
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 2);
+	PROBE_COUNT(COUNTER_ALLOCATED, sizeof(vector_string) + sizeof(bucket) * BUCKETS);
+	alocator(puzzle);
+	pthread_mutex_init(&puzzle->lock, NULL);
+	pthread_cond_init(&puzzle->loaded, NULL);
+	return puzzle;
+}
+
+void database_destroy(vector_string *puzzle)
+{
+	pthread_cond_destroy(&puzzle->loaded);
+	pthread_mutex_destroy(&puzzle->lock);
+	if (puzzle->mapping)
+		munmap(puzzle->mapping, puzzle->mapped);
+	else
+	{
+		free(puzzle->arena);
+		free(puzzle->entries);
+	}
+	for (int index = 0; index < BUCKETS; ++index)
+		free(puzzle->buckets[index].members);
+	free(puzzle->buckets);
+	if (puzzle->chosen)
+	{
+		for (int index = 0; index < BUCKETS; ++index)
+			free(puzzle->chosen->parts[index].members);
+		free(puzzle->chosen);
+	}
+	if (puzzle->set)
+		munmap(puzzle->set, sizeof(bin) * puzzle->bins);
+	free(puzzle->played);
+	free(puzzle->places);
+	free(puzzle->pool);
+	free(puzzle);
+}
+
+// this is called when we initialize a vector_string type
+// or when we want to allocate more memory into it
+void alocator(vector_string *vector)
+{
+	// a packed database can not grow in place
+	if (vector->mapping)
+		database_detach(vector);
+
+	// if it is first initialization
+	if (!vector->entries)
+	{
+		vector->entries = (entry *) malloc(sizeof(entry) * vector->dim);
+		vector->pool = (int *) malloc(sizeof(int) * vector->dim);
+		vector->places = (place *) malloc(sizeof(place) * vector->dim);
+		if (!vector->entries || !vector->pool || !vector->places)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		PROBE_COUNT(COUNTER_ALLOCATIONS, 3);
+		PROBE_COUNT(COUNTER_ALLOCATED, (sizeof(entry) + sizeof(int) + sizeof(place)) * vector->dim);
+	}
+	// if the vector_string needs more memory
+	else
+	{
+		entry *eaux = (entry *) realloc(vector->entries, sizeof(entry) * 2 * (vector->dim));
+		if (eaux)
+			vector->entries = eaux;
+		int *paux = (int *) realloc(vector->pool, sizeof(int) * 2 * (vector->dim));
+		if (paux)
+			vector->pool = paux;
+		place *laux = (place *) realloc(vector->places, sizeof(place) * 2 * (vector->dim));
+		if (laux)
+			vector->places = laux;
+		PROBE_COUNT(COUNTER_ALLOCATIONS, 3);
+		PROBE_COUNT(COUNTER_ALLOCATED, (sizeof(entry) + sizeof(int) + sizeof(place)) * 2 * vector->dim);
+		if (eaux && paux && laux)
+			vector->dim *= 2;
+		// Heap Memory is full
+		else
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+	}
+}
+
+// make room for at least bytes more characters in the arena
+// (the entries keep offsets, so the arena is free to move)
+void arena_reserve(vector_string *vector, size_t bytes)
+{
+	if (vector->used + bytes <= vector->capacity)
+		return;
+	// a packed database can not grow in place
+	if (vector->mapping)
+		database_detach(vector);
+
+	size_t capacity = vector->capacity ? vector->capacity : BUFLEN;
+	while (capacity < vector->used + bytes)
+		capacity *= 2;
+
+	char *aux = (char *) realloc(vector->arena, capacity);
+	// Heap Memory is full
+	if (!aux)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 1);
+	PROBE_COUNT(COUNTER_ALLOCATED, capacity);
+	vector->arena = aux;
+	vector->capacity = capacity;
+}
+
+// map the input file in memory and store each line (word | expression)
+// in vec -- the puzzle database; every line is copied once at the end
+// of the arena and cleaned there
+// returns FAILURE if the file could not be read
+int expression_store(int source, vector_string *vec)
+{
+	struct stat info;
+	if (fstat(source, &info) < 0)
+		return FAILURE;
+	if (info.st_size == 0)
+		return SUCCESS;
+
+	char *file = (char *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, source, 0);
+	// error if the file couldn't be mapped
+	if (file == MAP_FAILED)
+		return FAILURE;
+	madvise(file, info.st_size, MADV_SEQUENTIAL);
+
+	// a file with more characters than the alphabet has room for is left
+	// out whole (not from the line where it fills up)
+	if (!glyph_fits(&vec->glyphs, file, info.st_size))
+	{
+		vec->overflows++;
+		PROBE_COUNT(COUNTER_OVERFLOWS, 1);
+		munmap(file, info.st_size);
+		return SUCCESS;
+	}
+
+	// the cleaned lines are never longer than the file, so the arena
+	// does not move while the lines are copied into it
+	pthread_mutex_lock(&vec->lock);
+	arena_reserve(vec, info.st_size);
+	pthread_mutex_unlock(&vec->lock);
+
+	// expressions stored but not published yet are after vec->count
+	int count = vec->count;
+
+	char *end = file + info.st_size;
+	char *line = file;
+
+	// find each line boundary (memchr scans a word at a time)
+	bool loading = true;
+	while (line < end && loading)
+	{
+		char *eol = memchr(line, '\n', end - line);
+		eol = eol ? eol + 1 : end;
+
+		// every line is an expression, whatever its length
+		int read = eol - line;
+
+		// copy the line at the end of the arena and clean it for printing
+		char *expression = vec->arena + vec->used;
+		memcpy(expression, line, read);
+		PROBE_BEGIN(clean);
+		int size = clean_for_print(expression, read, &vec->glyphs);
+		PROBE_END(PHASE_CLEAN, clean);
+		line = eol;
+
+		// the same expression is stored once (the parsed parts of a
+		// database are checked when they are added to it)
+		unsigned int hash = size ? checksum(expression, size, 0) : 0;
+		if (size && !vec->staging && database_insert(vec, expression, size, hash, count) >= 0)
+		{
+			vec->duplicates++;
+			vec->duplicated += size;
+			PROBE_COUNT(COUNTER_DUPLICATES, 1);
+			continue;
+		}
+
+		// append the result into the puzzle database
+		if (size)
+		{
+			// if the database is full call the allocator
+			if (count == vec->dim)
+			{
+				pthread_mutex_lock(&vec->lock);
+				alocator(vec);
+				pthread_mutex_unlock(&vec->lock);
+			}
+
+			count++;
+			vec->entries[count - 1].offset = vec->used;
+			vec->entries[count - 1].size = size;
+			vec->entries[count - 1].hash = hash;
+			vec->entries[count - 1].words = 1;
+			memset(&vec->entries[count - 1].letters, 0, sizeof(charset));
+			for (int index = 0; index < size; ++index)
+			{
+				charset_add(&vec->entries[count - 1].letters, (unsigned char) expression[index]);
+				vec->entries[count - 1].words += expression[index] == ' ';
+			}
+			vec->entries[count - 1].bucket = bucket_of(&vec->entries[count - 1]);
+			vec->used += size;
+
+			if (count - vec->count == BATCH)
+				loading = publish(vec, count);
+		}
+	}
+	publish(vec, count);
+
+	// all the characters are in the arena now
+	munmap(file, info.st_size);
+	return SUCCESS;
+}
+
+// store a file in vec, a packed database or a text file with a
+// word | expression on each line
+// returns FAILURE if the file could not be parsed
+int database_store(int source, vector_string *vec)
+{
+	PROBE_BEGIN(load);
+	int result = database_packed(source) ? pack_store(source, vec) : expression_store(source, vec);
+	PROBE_END(PHASE_LOAD, load);
+	return result;
+}
+
+// if a file is a packed database
+static bool database_packed(int source)
+{
+	char magic[sizeof(PACK_MAGIC) - 1];
+	return pread(source, magic, sizeof(magic), 0) == sizeof(magic) &&
+		!memcmp(magic, PACK_MAGIC, sizeof(magic));
+}
+
+// check a file before it is stored: it has to be a regular file, and a
+// packed database needs a header of this version that fits its size
+// (the checksum is checked when it is stored)
+// returns FAILURE if the file can not be stored
+int database_check(int source)
+{
+	struct stat info;
+	pack_header header;
+	if (fstat(source, &info) < 0 || !S_ISREG(info.st_mode))
+		return FAILURE;
+	if (!database_packed(source))
+		return SUCCESS;
+	return pread(source, &header, sizeof(header), 0) == sizeof(header) &&
+		pack_fits(&header, info.st_size) ? SUCCESS : FAILURE;
+}
+
+// store more files in vec, in their order: the first one is stored by
+// the caller while up to threads threads (0 for one on each core) parse
+// the others in databases of their own, which are added to vec one
+// after another as soon as the ones before them are in; the files after
+// one that can not be parsed are left out
+// returns the index of the file that could not be parsed, -1 if every
+// file was stored
+int database_store_files(vector_string *vec, const int *files, int count, int threads)
+{
+	if (count <= 0)
+		return -1;
+	if (threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads > count - 1)
+		threads = count - 1;
+
+	loading_files job = {vec, files, count, 1};
+	job.parts = (vector_string **) malloc(sizeof(vector_string *) * count);
+	job.parsed = (bool *) calloc(count, sizeof(bool));
+	job.broken = (bool *) calloc(count, sizeof(bool));
+	pthread_t *workers = (pthread_t *) malloc(sizeof(pthread_t) * (threads ? threads : 1));
+	if (!job.parts || !job.parsed || !job.broken || !workers)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	for (int index = 1; index < count; ++index)
+	{
+		job.parts[index] = database_create();
+		job.parts[index]->staging = true;
+	}
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.done, NULL);
+
+	for (int index = 0; index < threads; ++index)
+		if (pthread_create(&workers[index], NULL, parse_files, &job))
+		{
+			fprintf(stderr, "[Error] Could not start a thread\n");
+			exit(FAILURE);
+		}
+
+	// the first file goes straight in, so it can be played at once
+	int failed = database_store(files[0], vec) == SUCCESS ? -1 : 0;
+	for (int index = 1; index < count; ++index)
+	{
+		pthread_mutex_lock(&vec->lock);
+		bool cancel = vec->cancel || failed >= 0;
+		pthread_mutex_unlock(&vec->lock);
+
+		// stop the threads, and the files they are parsing
+		if (cancel && !job.stop)
+		{
+			pthread_mutex_lock(&job.lock);
+			job.stop = true;
+			pthread_mutex_unlock(&job.lock);
+			for (int part = index; part < count; ++part)
+				database_cancel(job.parts[part]);
+		}
+
+		// wait for the file (the files not taken are never parsed)
+		pthread_mutex_lock(&job.lock);
+		while (!job.parsed[index] && (index < job.next || !job.stop))
+			pthread_cond_wait(&job.done, &job.lock);
+		pthread_mutex_unlock(&job.lock);
+
+		// a packed database is used as it is, it needs no parsing
+		vector_string *part = job.parts[index];
+		if (!cancel && database_packed(files[index]))
+			failed = database_store(files[index], vec) == SUCCESS ? -1 : index;
+		else if (!cancel && job.broken[index])
+			failed = index;
+		else if (!cancel)
+		{
+			database_append(vec, part->entries, part->count, part->arena, part->used, &part->glyphs);
+			vec->overflows += part->overflows;
+		}
+		database_destroy(part);
+	}
+
+	for (int index = 0; index < threads; ++index)
+		pthread_join(workers[index], NULL);
+	pthread_cond_destroy(&job.done);
+	pthread_mutex_destroy(&job.lock);
+	free(workers);
+	free(job.broken);
+	free(job.parsed);
+	free(job.parts);
+
+	// without a loader that waits for more files, the loading is over
+	if (!vec->loading)
+		database_unindex(vec);
+	return failed;
+}
+
+// a thread of database_store_files: parse the next file until there
+// are no more
+static void *parse_files(void *argument)
+{
+	loading_files *job = (loading_files *) argument;
+	while (true)
+	{
+		pthread_mutex_lock(&job->lock);
+		int index = job->next < job->count && !job->stop ? job->next++ : -1;
+		pthread_mutex_unlock(&job->lock);
+		if (index < 0)
+			return NULL;
+
+		bool broken = !database_packed(job->files[index]) &&
+			database_store(job->files[index], job->parts[index]) != SUCCESS;
+
+		pthread_mutex_lock(&job->lock);
+		job->parsed[index] = true;
+		job->broken[index] = broken;
+		pthread_cond_broadcast(&job->done);
+		pthread_mutex_unlock(&job->lock);
+	}
+}
+
+// add a copy of count entries and of the characters they point to in
+// arena (glyphs is their alphabet) at the end of the database and
+// publish them; the expressions already in the database are left out;
+// like expression_store, they are copied and checked without the lock
+// and published in batches, and if the two alphabets do not fit in one
+// nothing is added
+void database_append(vector_string *vec, const entry *entries, int count, const char *arena, size_t bytes, const alphabet *glyphs)
+{
+	if (!glyph_union(&vec->glyphs, glyphs))
+	{
+		vec->overflows++;
+		PROBE_COUNT(COUNTER_OVERFLOWS, 1);
+		return;
+	}
+
+	// the characters that are not ascii take the ones they have in the
+	// alphabet of vec, the expressions with them are written again
+	// unless they are the same
+	unsigned char characters[GLYPHS];
+	bool same = true;
+	for (int index = 0; index < glyphs->count; ++index)
+	{
+		int ch = glyph_find(&vec->glyphs, glyphs->codes[index]);
+		if (ch < 0)
+			ch = glyph_add(&vec->glyphs, glyphs->codes[index]);
+		characters[index] = ch;
+		same = same && ch == GLYPH + index;
+	}
+
+	// the arena does not move while the expressions are copied into it
+	pthread_mutex_lock(&vec->lock);
+	arena_reserve(vec, bytes);
+	pthread_mutex_unlock(&vec->lock);
+
+	int added = vec->count;
+	bool loading = true;
+	for (int index = 0; index < count && loading; ++index)
+	{
+		entry current = entries[index];
+		char *string = vec->arena + vec->used;
+		memcpy(string, arena + current.offset, current.size);
+		if (!same && (current.letters.bits[2] | current.letters.bits[3]))
+		{
+			current.letters.bits[2] = current.letters.bits[3] = 0;
+			for (int position = 0; position < current.size; ++position)
+				if ((unsigned char) string[position] >= GLYPH)
+				{
+					string[position] = characters[(unsigned char) string[position] - GLYPH];
+					charset_add(&current.letters, (unsigned char) string[position]);
+				}
+			current.hash = checksum(string, current.size, 0);
+		}
+		current.bucket = bucket_of(&current);
+
+		if (database_insert(vec, string, current.size, current.hash, added) >= 0)
+		{
+			vec->duplicates++;
+			vec->duplicated += current.size;
+			PROBE_COUNT(COUNTER_DUPLICATES, 1);
+			continue;
+		}
+
+		if (added == vec->dim)
+		{
+			pthread_mutex_lock(&vec->lock);
+			alocator(vec);
+			pthread_mutex_unlock(&vec->lock);
+		}
+		current.offset = vec->used;
+		vec->entries[added] = current;
+		vec->used += current.size;
+		added++;
+
+		if (added - vec->count == BATCH)
+			loading = publish(vec, added);
+	}
+	publish(vec, added);
+}
+
+// put the expression index in the set, unless the same one is there
+// returns the index of the same expression, -1 if it was put in
+int database_insert(vector_string *vec, const char *string, int size, unsigned int hash, int index)
+{
+	// a packed database used in place goes in the set now, when
+	// something else is added to it
+	if (vec->unindexed)
+	{
+		int count = vec->unindexed;
+		vec->unindexed = 0;
+		for (int packed = 0; packed < count; ++packed)
+			database_insert(vec, vec->arena + vec->entries[packed].offset, vec->entries[packed].size, vec->entries[packed].hash, packed);
+	}
+
+	// the set is at most half full, a larger one is made from the
+	// hashes in the slots, without reading the expressions again
+	if (2 * (size_t) (index + 1) > vec->bins)
+	{
+		// it is mapped apart (zeroed already) and asks for large pages:
+		// every probe goes to a random place of it
+		size_t bins = vec->bins ? 2 * vec->bins : 1024;
+		bin *set = (bin *) mmap(NULL, sizeof(bin) * bins, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (set == MAP_FAILED)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		madvise(set, sizeof(bin) * bins, MADV_HUGEPAGE);
+		PROBE_COUNT(COUNTER_ALLOCATIONS, 1);
+		PROBE_COUNT(COUNTER_ALLOCATED, sizeof(bin) * bins);
+		for (size_t slot = 0; slot < vec->bins; ++slot)
+			if (vec->set[slot].index)
+			{
+				size_t moved = vec->set[slot].hash & (bins - 1);
+				while (set[moved].index)
+					moved = (moved + 1) & (bins - 1);
+				set[moved] = vec->set[slot];
+			}
+		if (vec->set)
+			munmap(vec->set, sizeof(bin) * vec->bins);
+		vec->set = set;
+		vec->bins = bins;
+	}
+
+	// only the expressions with the same hash are compared
+	size_t slot = hash & (vec->bins - 1);
+	for (; vec->set[slot].index; slot = (slot + 1) & (vec->bins - 1))
+	{
+		const entry *same = &vec->entries[vec->set[slot].index - 1];
+		if (vec->set[slot].hash == hash && same->size == size &&
+			!memcmp(vec->arena + same->offset, string, size))
+			return vec->set[slot].index - 1;
+	}
+	vec->set[slot].hash = hash;
+	vec->set[slot].index = index + 1;
+	return -1;
+}
+
+// let the set go when the loading is over (it takes 16 bytes or more for
+// each expression); it is made again, from the hashes in the entries,
+// if another file is added later
+static void database_unindex(vector_string *vec)
+{
+	if (!vec->set)
+		return;
+	munmap(vec->set, sizeof(bin) * vec->bins);
+	vec->set = NULL;
+	vec->bins = 0;
+	vec->unindexed = vec->count;
+}
+
+// map a packed database (made by hangman-pack) and store it in vec;
+// in an empty database the file itself is used as arena and entries,
+// so there is nothing to parse or copy
+// returns FAILURE if the file is damaged or made by another version
+int pack_store(int source, vector_string *vec)
+{
+	struct stat info;
+	if (fstat(source, &info) < 0 || info.st_size < sizeof(pack_header))
+		return FAILURE;
+
+	char *file = (char *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, source, 0);
+	if (file == MAP_FAILED)
+		return FAILURE;
+
+	// error if the file was made by another version or is damaged
+	pack_header *header = (pack_header *) file;
+	alphabet *glyphs = (alphabet *) (file + sizeof(pack_header));
+	size_t table = sizeof(entry) * (size_t) header->count;
+	if (!pack_fits(header, info.st_size) ||
+		checksum(file + sizeof(pack_header), info.st_size - sizeof(pack_header), 0) != header->checksum ||
+		glyphs->count < 0 || glyphs->count > GLYPHS)
+	{
+		munmap(file, info.st_size);
+		return FAILURE;
+	}
+
+	// every entry has to point inside the arena (the arena is used in
+	// place, the checksum does not make a crafted file safe)
+	entry *entries = (entry *) (file + sizeof(pack_header) + sizeof(alphabet));
+	char *arena = file + sizeof(pack_header) + sizeof(alphabet) + table;
+	int count = header->count;
+	for (int index = 0; index < count; ++index)
+		if (entries[index].size < 0 || entries[index].offset > header->bytes ||
+			entries[index].size > header->bytes - entries[index].offset)
+		{
+			munmap(file, info.st_size);
+			return FAILURE;
+		}
+	if (!count)
+	{
+		munmap(file, info.st_size);
+		return SUCCESS;
+	}
+
+	pthread_mutex_lock(&vec->lock);
+	if (!vec->count && !vec->used && !vec->mapping && !vec->glyphs.count)
+	{
+		// use the file in place
+		int *paux = (int *) realloc(vec->pool, sizeof(int) * count);
+		if (paux)
+			vec->pool = paux;
+		place *laux = (place *) realloc(vec->places, sizeof(place) * count);
+		if (laux)
+			vec->places = laux;
+		if (!paux || !laux)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		PROBE_COUNT(COUNTER_ALLOCATIONS, 2);
+		PROBE_COUNT(COUNTER_ALLOCATED, (sizeof(int) + sizeof(place)) * count);
+		free(vec->entries);
+		free(vec->arena);
+		vec->entries = entries;
+		vec->arena = arena;
+		vec->dim = count;
+		vec->used = vec->capacity = header->bytes;
+		vec->mapping = file;
+		vec->mapped = info.st_size;
+		for (int index = 0; index < glyphs->count; ++index)
+			glyph_add(&vec->glyphs, glyphs->codes[index]);
+
+		// hangman-pack leaves out the duplicates, so the set is only
+		// made if another file is added (with the hashes of the file)
+		vec->unindexed = count;
+		pthread_mutex_unlock(&vec->lock);
+		publish(vec, count);
+		return SUCCESS;
+	}
+	pthread_mutex_unlock(&vec->lock);
+
+	// append a copy of the file at the end of the database
+	database_append(vec, entries, count, arena, header->bytes, glyphs);
+	munmap(file, info.st_size);
+	return SUCCESS;
+}
+
+// if the header of a packed database is of this version and tells the
+// size of the file (size bytes)
+static bool pack_fits(const pack_header *header, size_t size)
+{
+	return header->version == PACK_VERSION && header->count >= 0 &&
+		size == sizeof(pack_header) + sizeof(alphabet) + sizeof(entry) * (size_t) header->count + header->bytes;
+}
+
+// copy a packed database used in place to the heap, so it can grow
+void database_detach(vector_string *vec)
+{
+	entry *entries = (entry *) malloc(sizeof(entry) * vec->dim);
+	char *arena = (char *) malloc(vec->capacity);
+	if (!entries || !arena)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 2);
+	PROBE_COUNT(COUNTER_ALLOCATED, sizeof(entry) * vec->dim + vec->capacity);
+	memcpy(entries, vec->entries, sizeof(entry) * vec->count);
+	memcpy(arena, vec->arena, vec->used);
+	munmap(vec->mapping, vec->mapped);
+
+	vec->entries = entries;
+	vec->arena = arena;
+	vec->mapping = NULL;
+	vec->mapped = 0;
+}
+
+// make the expressions stored up to count available to the players
+// returns false if the loading was canceled
+bool publish(vector_string *vec, int count)
+{
+	pthread_mutex_lock(&vec->lock);
+	if (!vec->staging)
+		played_reserve(vec, count);
+	for (int index = vec->count; index < count; ++index)
+	{
+		vec->chars += vec->entries[index].size;
+		if (vec->staging)
+			continue;
+		vec->places[index].pool = vec->available;
+		vec->pool[vec->available++] = index;
+		bucket_add(vec, index);
+
+		// played before the snapshot: it goes out of the pool again
+		if ((vec->played[index >> 6] >> (index & 63)) & 1)
+		{
+			pool_remove(vec, index);
+			if (index != vec->resumed)
+			{
+				vec->chars -= vec->entries[index].size;
+				vec->exprs--;
+			}
+		}
+	}
+	PROBE_COUNT(COUNTER_EXPRESSIONS, count - vec->count);
+	vec->exprs += count - vec->count;
+	vec->count = count;
+	pthread_cond_broadcast(&vec->loaded);
+	bool loading = !vec->cancel;
+	pthread_mutex_unlock(&vec->lock);
+	return loading;
+}
+
+// cleaning the passed string in order to be printed on console:
+// characters that are not printable are removed, multiple spaces become
+// one, spaces at the ends are removed and letters become lowercase;
+// the utf-8 characters become their character in glyphs (without glyphs
+// they are removed); it is a single pass that writes the result over
+// the string
+// returns the size of the result, -1 if it has a character that is not
+// in glyphs and does not fit in it any more
+int clean_for_print(char *string, int size, alphabet *glyphs)
+{
+	int written = 0;
+	int index = 0;
+
+#ifdef __SSE2__
+	// blocks of 16 printable characters without spaces or capital
+	// letters (most of a word list) are copied as they are
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i del = _mm_set1_epi8(0x7F);
+	const __m128i before_a = _mm_set1_epi8('A' - 1);
+	const __m128i after_z = _mm_set1_epi8('Z' + 1);
+	for (; index + 16 <= size; index += 16)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i *) (string + index));
+		__m128i printable = _mm_and_si128(_mm_cmpgt_epi8(block, space), _mm_cmplt_epi8(block, del));
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(block, before_a), _mm_cmplt_epi8(block, after_z));
+		if (_mm_movemask_epi8(_mm_andnot_si128(upper, printable)) != 0xFFFF)
+			break;
+		_mm_storeu_si128((__m128i *) (string + written), block);
+		written += 16;
+	}
+#endif
+
+	for (; index < size; ++index)
+	{
+		unsigned char ch = clean_table[(unsigned char) string[index]];
+		// a character that is not ascii is decoded once, here (a broken
+		// utf-8 sequence is removed one byte at a time)
+		int code, length;
+		if (!ch && glyphs && (unsigned char) string[index] >= 0x80 &&
+			(length = glyph_decode(string + index, size - index, &code)))
+		{
+			int found = glyph_character(glyphs, code);
+			if (found < 0)
+				return -1;
+			ch = found;
+			index += length - 1;
+		}
+		// if we have multiple spaces in the string or charaters that are
+		// not printable, we remove them in order for the game to be simple
+		if (!ch || (ch == ' ' && (!written || string[written - 1] == ' ')))
+			continue;
+		string[written++] = ch;
+	}
+
+	if (written && string[written - 1] == ' ')
+		written--;
+	return written;
+}
+
+// create a hidden string (string with _ where a letter should be guessed)
+// from the word | expression of the game, in one pass and in place:
+// banana -> B _ _ _ _ A, then the shown letters are revealed everywhere
+// using the position lists: B _ _ _ _ A -> B A _ A _ A
+void create_hidden_string(data *game)
+{
+	char *string = game->string;
+	char *hidden = game->hidden;
+
+	int index = 0;
+	while (string[index])
+	{
+		if (string[index] == ' ')
+		{
+			hidden[index++] = ' ';
+			continue;
+		}
+
+		// iterate over each word in the hidden expression
+		int begin = index;
+		while (string[index] && string[index] != ' ')
+			hidden[index++] = '_';
+
+		// words of one letter are fully hidden, the others show
+		// their first and last letter
+		if (index - begin > 1)
+		{
+			charset_add(&game->shown, (unsigned char) string[begin]);
+			if (index - begin > 2)
+				charset_add(&game->shown, (unsigned char) string[index - 1]);
+		}
+	}
+	hidden[index] = '\0';
+
+	// reveal every position of the shown letters (one set bit after
+	// another, the spaces are shown already)
+	for (int word = 0; word < CHARSET / 64; ++word)
+		for (unsigned long long bits = game->shown.bits[word] & (word ? ~0ULL : ~0ULL << '!'); bits; bits &= bits - 1)
+		{
+			int ch = 64 * word + __builtin_ctzll(bits);
+			for (int position = game->first[ch]; position >= 0; position = game->next[position])
+				hidden[position] = charset_shown(ch);
+			charset_remove(&game->secret, ch);
+		}
+}
+
+// build the character sets and the position lists of the current
+// game from its string and the letters in it; the characters that are
+// not ascii are found by code point (from glyphs, their alphabet) in a
+// set of the game, so a guess does not look at the whole alphabet
+void index_characters(data *game, const charset *letters, const alphabet *glyphs)
+{
+	memset(game->first, -1, sizeof(game->first));
+	for (int index = strlen(game->string) - 1; index >= 0; --index)
+	{
+		int ch = (unsigned char) game->string[index];
+		game->next[index] = game->first[ch];
+		game->first[ch] = index;
+	}
+
+	// the set is only cleared after a match that used it
+	if (game->glyphs.count)
+	{
+		memset(game->glyphs.table, 0, sizeof(game->glyphs.table));
+		game->glyphs.count = 0;
+	}
+	for (int word = GLYPH / 64; word < CHARSET / 64; ++word)
+		for (unsigned long long bits = letters->bits[word]; bits; bits &= bits - 1)
+		{
+			int ch = 64 * word + __builtin_ctzll(bits);
+			game->glyphs.codes[ch - GLYPH] = glyphs->codes[ch - GLYPH];
+			glyph_insert(&game->glyphs, glyphs->codes[ch - GLYPH], ch);
+		}
+
+	// every character needs to be guessed, except the spaces
+	game->secret = *letters;
+	memset(&game->shown, 0, sizeof(charset));
+	memset(&game->tried, 0, sizeof(charset));
+	charset_remove(&game->secret, ' ');
+	if (charset_has(letters, ' '))
+		charset_add(&game->shown, ' ');
+}
+
+// find if a character (a code point) is in the hidden string and is not
+// discovered yet; one that no expression of the database has is a
+// mistake too (the ones that are not printed are not characters)
+// returns 1 if it was discovered now, -1 for a new mistake and 0 otherwise
+int find_character(data *game, int ch)
+{
+	if (ch < 0)
+		return 0;
+	if (glyph_space(ch))
+		ch = ' ';
+	if (ch < GLYPH)
+		ch = tolower(ch);
+	else
+	{
+		int code = glyph_lower(ch);
+		ch = glyph_find(&game->glyphs, code);
+		if (ch < 0 && game->source)
+			ch = glyph_find(game->source, code);
+		// it has no character in the charsets, it was tried if it is
+		// in the mistakes
+		if (ch < 0)
+			return glyph_width(code) && !glyph_tried(game, code) ? -1 : 0;
+	}
+
+	// reveal only the positions where the character is
+	if (charset_has(&game->secret, ch))
+	{
+		for (int index = game->first[ch]; index >= 0; index = game->next[index])
+			game->hidden[index] = charset_shown(ch);
+		charset_remove(&game->secret, ch);
+		charset_add(&game->shown, ch);
+		return 1;
+	}
+	if (charset_has(&game->shown, ch) || charset_has(&game->tried, ch))
+		return 0;
+
+	charset_add(&game->tried, ch);
+	return -1;
+}
+
+// find a character by the code point of its small letter
+// returns the character, -1 if it is not in glyphs
+int glyph_find(const alphabet *glyphs, int code)
+{
+	for (unsigned int slot = (unsigned int) code * 2654435761u >> 16; ; ++slot)
+	{
+		unsigned int value = __atomic_load_n(&glyphs->table[slot % (2 * GLYPHS)], __ATOMIC_ACQUIRE);
+		if (!value)
+			return -1;
+		if ((int) (value >> 8) == code)
+			return GLYPH + (value & 0xFF);
+	}
+}
+
+// add the code point of a small letter to glyphs
+// returns its character, -1 if glyphs is full
+int glyph_add(alphabet *glyphs, int code)
+{
+	if (glyphs->count == GLYPHS)
+		return -1;
+	int ch = GLYPH + glyphs->count;
+	glyphs->codes[ch - GLYPH] = code;
+	glyph_insert(glyphs, code, ch);
+	return ch;
+}
+
+// put a character in the table of glyphs (at most half full); the slot
+// is written at once, after the code point, for the games that read it
+static void glyph_insert(alphabet *glyphs, int code, int ch)
+{
+	unsigned int slot = (unsigned int) code * 2654435761u >> 16;
+	while (glyphs->table[slot % (2 * GLYPHS)])
+		slot++;
+	__atomic_store_n(&glyphs->table[slot % (2 * GLYPHS)], (unsigned int) code << 8 | (ch - GLYPH), __ATOMIC_RELEASE);
+	glyphs->count++;
+}
+
+// the character of a code point that is not ascii, added to glyphs if
+// it is new: ' ' for the spaces and 0 for what is not printed
+// returns -1 if glyphs is full
+static int glyph_character(alphabet *glyphs, int code)
+{
+	int ch = glyph_find(glyphs, code);
+	if (ch >= 0)
+		return ch;
+	int lower = glyph_lower(code);
+	if (lower != code && (ch = glyph_find(glyphs, lower)) >= 0)
+		return ch;
+
+	if (glyph_space(code))
+		return ' ';
+	if (!glyph_width(code))
+		return 0;
+	return glyph_add(glyphs, lower);
+}
+
+// if the characters of size bytes of text (a text file) fit in glyphs
+// with the ones it has: they are added to a copy in the order
+// clean_for_print adds them, the blocks of ascii are skipped
+static bool glyph_fits(const alphabet *glyphs, const char *text, size_t size)
+{
+	alphabet copy = *glyphs;
+	size_t index = 0;
+	while (index < size)
+	{
+#ifdef __SSE2__
+		while (index + 16 <= size && !_mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (text + index))))
+			index += 16;
+		if (index == size)
+			break;
+#endif
+		// a broken utf-8 sequence is skipped one byte at a time, as
+		// clean_for_print removes it
+		int code, length = 0;
+		if ((unsigned char) text[index] >= 0x80)
+			length = glyph_decode(text + index, size - index < 4 ? size - index : 4, &code);
+		if (length && glyph_character(&copy, code) < 0)
+			return false;
+		index += length ? length : 1;
+	}
+	return true;
+}
+
+// if the characters of other fit in glyphs with the ones it has
+static bool glyph_union(const alphabet *glyphs, const alphabet *other)
+{
+	int missing = 0;
+	for (int index = 0; index < other->count; ++index)
+		missing += glyph_find(glyphs, other->codes[index]) < 0;
+	return glyphs->count + missing <= GLYPHS;
+}
+
+// if a code point is one of the spaces of unicode (they are cleaned
+// to ' ')
+static bool glyph_space(int code)
+{
+	return code == 0xA0 || (code >= 0x2000 && code <= 0x200A) || code == 0x202F || code == 0x205F || code == 0x3000;
+}
+
+// if a code point that is not in the alphabet was already tried: the
+// mistakes table has it (utf-8 is never found inside another character)
+static bool glyph_tried(const data *game, int code)
+{
+	char shown[5];
+	shown[glyph_encode(glyph_upper(code), shown)] = '\0';
+	return strstr(game->mistakes, shown);
+}
+
+// code point of a character of the match (from the alphabet of the
+// database for the characters that are not in the expression)
+int glyph_code(const data *game, int ch)
+{
+	if (ch < GLYPH)
+		return ch;
+	return game->first[ch] >= 0 || !game->source ? game->glyphs.codes[ch - GLYPH] : game->source->codes[ch - GLYPH];
+}
+
+// small letter of a code point (the same code point if it has none)
+int glyph_lower(int code)
+{
+	if (code < GLYPH)
+		return tolower(code);
+	for (int index = 0; index < sizeof(cases) / sizeof(cases[0]); ++index)
+		if (code >= cases[index][0] && code <= cases[index][1] &&
+			(code - cases[index][0]) % cases[index][3] == 0)
+			return code + cases[index][2];
+	return code;
+}
+
+// capital letter of a code point (the same code point if it has none)
+int glyph_upper(int code)
+{
+	if (code < GLYPH)
+		return toupper(code);
+	for (int index = 0; index < sizeof(cases) / sizeof(cases[0]); ++index)
+		if (code >= cases[index][0] + cases[index][2] && code <= cases[index][1] + cases[index][2] &&
+			(code - cases[index][0] - cases[index][2]) % cases[index][3] == 0)
+			return code - cases[index][2];
+	return code;
+}
+
+// columns a code point takes on a terminal (0 if it is not printed)
+int glyph_width(int code)
+{
+	if (code < GLYPH)
+		return code >= ' ' && code < 0x7F;
+	for (int index = 0; index < sizeof(widths) / sizeof(widths[0]) && code >= widths[index][0]; ++index)
+		if (code <= widths[index][1])
+			return widths[index][2];
+	return code <= 0x10FFFF;
+}
+
+// decode the utf-8 character at the start of text (size bytes)
+// returns its bytes, 0 if it is broken or longer than needed
+int glyph_decode(const char *text, int size, int *code)
+{
+	const unsigned char *bytes = (const unsigned char *) text;
+	if (size <= 0)
+		return 0;
+	if (bytes[0] < 0x80)
+	{
+		*code = bytes[0];
+		return 1;
+	}
+
+	// the first byte has the length, the others 6 bits each
+	static const int least[5] = {0, 0, 0x80, 0x800, 0x10000};
+	int length = bytes[0] >= 0xF8 ? 0 : bytes[0] >= 0xF0 ? 4 : bytes[0] >= 0xE0 ? 3 : bytes[0] >= 0xC0 ? 2 : 0;
+	if (!length || length > size)
+		return 0;
+	int value = bytes[0] & (0x7F >> length);
+	for (int index = 1; index < length; ++index)
+	{
+		if ((bytes[index] & 0xC0) != 0x80)
+			return 0;
+		value = value << 6 | (bytes[index] & 0x3F);
+	}
+	if (value < least[length] || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+		return 0;
+	*code = value;
+	return length;
+}
+
+// encode a code point in utf-8 (at most 4 bytes, not null terminated)
+// returns the bytes written
+int glyph_encode(int code, char *text)
+{
+	if (code < 0x80)
+	{
+		text[0] = code;
+		return 1;
+	}
+	int length = code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+	for (int index = length - 1; index > 0; --index, code >>= 6)
+		text[index] = 0x80 | (code & 0x3F);
+	text[0] = (0xF00 >> length) | code;
+	return length;
+}
+
+// write size characters of string (ascii or characters of glyphs, as
+// capital letters if upper is set) in text as utf-8, null terminated;
+// text needs 4 bytes for each character and one more
+// returns the bytes written
+int glyph_text(const alphabet *glyphs, const char *string, int size, char *text, bool upper)
+{
+	int written = 0;
+	for (int index = 0; index < size; ++index)
+	{
+		int ch = (unsigned char) string[index];
+		if (ch < GLYPH)
+			text[written++] = ch;
+		else
+			written += glyph_encode(upper ? glyph_upper(glyphs->codes[ch - GLYPH]) : glyphs->codes[ch - GLYPH], text + written);
+	}
+	text[written] = '\0';
+	return written;
+}
+
+// length, words and distinct characters of an expression (from its
+// entry, the characters are not read)
+static void dimensions_of(const entry *expression, int values[3])
+{
+	values[0] = expression->size;
+	values[1] = expression->words;
+	values[2] = -charset_has(&expression->letters, ' ');
+	for (int word = 0; word < CHARSET / 64; ++word)
+		values[2] += __builtin_popcountll(expression->letters.bits[word]);
+}
+
+// bucket of an expression, kept in its entry when it is stored
+static int bucket_of(const entry *expression)
+{
+	int values[3];
+	dimensions_of(expression, values);
+	int length = values[0] < BUCKET_LENGTHS ? values[0] : BUCKET_LENGTHS - 1;
+	int words = values[1] < BUCKET_WORDS ? values[1] : BUCKET_WORDS - 1;
+	int distinct = values[2] < BUCKET_DISTINCT ? values[2] : BUCKET_DISTINCT - 1;
+	return (length * BUCKET_WORDS + words) * BUCKET_DISTINCT + distinct;
+}
+
+// put a new expression in its bucket, with the available ones
+static void bucket_add(vector_string *vec, int index)
+{
+	// (the one of a packed file is checked, it is used as an index)
+	int which = vec->entries[index].bucket;
+	if (which < 0 || which >= BUCKETS)
+		which = bucket_of(&vec->entries[index]);
+	bucket *current = &vec->buckets[which];
+	bucket_grow(current);
+
+	// the first played one (if any) moves to the end
+	if (current->count > current->available)
+	{
+		int moved = current->members[current->available];
+		current->members[current->count] = moved;
+		vec->places[moved].member = current->count;
+	}
+	current->members[current->available] = index;
+	vec->places[index].bucket = which;
+	vec->places[index].member = current->available;
+	current->available++;
+	current->count++;
+	selection_update(vec, which, index, 1);
+}
+
+// make room for one more member in a bucket
+static void bucket_grow(bucket *current)
+{
+	if (current->count < current->capacity)
+		return;
+	int capacity = current->capacity ? 2 * current->capacity : 16;
+	int *aux = (int *) realloc(current->members, sizeof(int) * capacity);
+	if (!aux)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 1);
+	PROBE_COUNT(COUNTER_ALLOCATED, sizeof(int) * capacity);
+	current->members = aux;
+	current->capacity = capacity;
+}
+
+// take an available expression out of the pool and out of its bucket
+static void pool_remove(vector_string *vec, int index)
+{
+	int last = vec->pool[--vec->available];
+	vec->pool[vec->places[index].pool] = last;
+	vec->places[last].pool = vec->places[index].pool;
+
+	bucket *current = &vec->buckets[vec->places[index].bucket];
+	int member = vec->places[index].member;
+	last = current->members[--current->available];
+	current->members[member] = last;
+	vec->places[last].member = member;
+	current->members[current->available] = index;
+	vec->places[index].member = current->available;
+	vec->played[index >> 6] |= 1ULL << (index & 63);
+	selection_update(vec, vec->places[index].bucket, index, -1);
+}
+
+// make the bitmap of the played expressions hold count of them (the
+// new words are zeroed)
+static void played_reserve(vector_string *vec, int count)
+{
+	int words = (count + 63) / 64;
+	if (words <= vec->words)
+		return;
+	if (words < 2 * vec->words)
+		words = 2 * vec->words;
+
+	unsigned long long *aux = (unsigned long long *) realloc(vec->played, sizeof(unsigned long long) * words);
+	if (!aux)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 1);
+	PROBE_COUNT(COUNTER_ALLOCATED, sizeof(unsigned long long) * words);
+	memset(aux + vec->words, 0, sizeof(unsigned long long) * (words - vec->words));
+	vec->played = aux;
+	vec->words = words;
+}
+
+// buckets of a dimension chosen by a filter, from low to high; partial
+// is set if the last one (that holds all the larger expressions) is
+// chosen but only some of its expressions fit the filter
+// returns the number of them
+static int selection_bounds(const selection *filter, int which, int limit, int *low, int *high, bool *partial)
+{
+	const int *bounds = which == 0 ? filter->length : which == 1 ? filter->words : filter->distinct;
+	*low = bounds[0] < limit ? bounds[0] : limit - 1;
+	*high = bounds[1] && bounds[1] < limit ? bounds[1] : limit - 1;
+	*partial = *high == limit - 1 && (bounds[1] || bounds[0] > limit - 1);
+	return *high >= *low ? *high - *low + 1 : 0;
+}
+
+// if an expression fits a filter, by its own length, words and distinct
+// characters
+static bool selection_fits(const vector_string *vec, const selection *filter, int index)
+{
+	const int *bounds[3] = {filter->length, filter->words, filter->distinct};
+	int values[3];
+	dimensions_of(&vec->entries[index], values);
+	for (int which = 0; which < 3; ++which)
+		if (values[which] < bounds[which][0] || (bounds[which][1] && values[which] > bounds[which][1]))
+			return false;
+	return true;
+}
+
+// make the groups of a filter, unless they are the ones of the last
+// filter: every bucket is looked at (and every member of a last bucket
+// the filter only takes a part of), once for each new filter
+static void selection_prepare(vector_string *vec, const selection *filter)
+{
+	if (!vec->chosen)
+	{
+		vec->chosen = (choice *) calloc(1, sizeof(choice));
+		if (!vec->chosen)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		PROBE_COUNT(COUNTER_ALLOCATIONS, 1);
+		PROBE_COUNT(COUNTER_ALLOCATED, sizeof(choice));
+	}
+	choice *chosen = vec->chosen;
+	if (chosen->valid && !memcmp(&chosen->filter, filter, sizeof(selection)))
+		return;
+
+	chosen->filter = *filter;
+	chosen->valid = true;
+	chosen->groups = 0;
+	chosen->total = 0;
+	memset(chosen->group, -1, sizeof(chosen->group));
+	memset(chosen->tree, 0, sizeof(chosen->tree));
+
+	int length[2], words[2], distinct[2];
+	bool partial[3];
+	if (!selection_bounds(filter, 0, BUCKET_LENGTHS, &length[0], &length[1], &partial[0]) ||
+		!selection_bounds(filter, 1, BUCKET_WORDS, &words[0], &words[1], &partial[1]) ||
+		!selection_bounds(filter, 2, BUCKET_DISTINCT, &distinct[0], &distinct[1], &partial[2]))
+		return;
+	for (int size = length[0]; size <= length[1]; ++size)
+		for (int word = words[0]; word <= words[1]; ++word)
+			for (int letters = distinct[0]; letters <= distinct[1]; ++letters)
+			{
+				int which = (size * BUCKET_WORDS + word) * BUCKET_DISTINCT + letters;
+				bucket *current = &vec->buckets[which];
+				int group = chosen->groups++;
+				chosen->group[which] = group;
+				chosen->buckets[group] = which;
+				chosen->partial[which] = (partial[0] && size == length[1]) ||
+					(partial[1] && word == words[1]) || (partial[2] && letters == distinct[1]);
+
+				int count = current->available;
+				if (chosen->partial[which])
+				{
+					bucket *part = &chosen->parts[which];
+					part->available = part->count = 0;
+					for (int member = 0; member < current->available; ++member)
+					{
+						int index = current->members[member];
+						vec->places[index].part = -1;
+						if (!selection_fits(vec, filter, index))
+							continue;
+						bucket_grow(part);
+						vec->places[index].part = part->available;
+						part->members[part->available++] = index;
+						part->count++;
+					}
+					count = part->available;
+				}
+
+				chosen->total += count;
+				chosen->tree[group + 1] = count;
+			}
+
+	// each node of the tree is complete when it is added to the next
+	// one that holds it
+	for (int node = 1; node <= BUCKETS; ++node)
+	{
+		int parent = node + (node & -node);
+		if (parent <= BUCKETS)
+			chosen->tree[parent] += chosen->tree[node];
+	}
+}
+
+// follow the available expressions of a bucket in the groups of the last
+// filter: index was added to it (change 1) or taken out (change -1)
+static void selection_update(vector_string *vec, int which, int index, int change)
+{
+	choice *chosen = vec->chosen;
+	if (!chosen || !chosen->valid || chosen->group[which] < 0)
+		return;
+
+	// a part only has the members that fit the filter, the last one
+	// takes the place of one that is taken out
+	if (chosen->partial[which])
+	{
+		bucket *part = &chosen->parts[which];
+		if (change > 0)
+		{
+			vec->places[index].part = -1;
+			if (!selection_fits(vec, &chosen->filter, index))
+				return;
+			bucket_grow(part);
+			vec->places[index].part = part->available;
+			part->members[part->available++] = index;
+			part->count++;
+		}
+		else
+		{
+			int member = vec->places[index].part;
+			if (member < 0)
+				return;
+			int last = part->members[--part->available];
+			part->members[member] = last;
+			vec->places[last].part = member;
+			vec->places[index].part = -1;
+			part->count--;
+		}
+	}
+
+	chosen->total += change;
+	for (int node = chosen->group[which] + 1; node <= BUCKETS; node += node & -node)
+		chosen->tree[node] += change;
+}
+
+// available expressions in the buckets chosen by a filter (all of them
+// without a filter)
+static int selection_count(vector_string *vec, const selection *filter)
+{
+	if (!filter)
+		return vec->available;
+	selection_prepare(vec, filter);
+	return vec->chosen->total;
+}
+
+// the expression at position random of the available ones in the buckets
+// chosen by a filter (random is below their count): the group is found
+// going down the tree, in log(BUCKETS) steps
+static int selection_draw(vector_string *vec, const selection *filter, unsigned int random)
+{
+	if (!filter)
+		return vec->pool[random];
+
+	selection_prepare(vec, filter);
+	choice *chosen = vec->chosen;
+	int node = 0;
+	for (int step = BUCKETS; step; step >>= 1)
+		if (node + step <= BUCKETS && chosen->tree[node + step] <= random)
+		{
+			node += step;
+			random -= chosen->tree[node];
+		}
+
+	int which = chosen->buckets[node];
+	const bucket *current = chosen->partial[which] ? &chosen->parts[which] : &vec->buckets[which];
+	return current->members[random];
+}
+
+// start a new game logic
+// returns FAILURE when every word | expression was played
+int start(data *game, vector_string *puzzle)
+{
+	return start_selection(game, puzzle, NULL);
+}
+
+// start a new game with an expression of the buckets chosen by filter
+// (any expression without a filter), every one of them is as likely;
+// returns FAILURE when all of them were played
+int start_selection(data *game, vector_string *puzzle, const selection *filter)
+{
+	pthread_mutex_lock(&puzzle->lock);
+
+	// if a new game is started the last word is no longer counted
+	// (it was already taken out of the pool when it was chosen); the
+	// match of a snapshot may not be loaded yet, then it is left out
+	// when it is published
+	if (game->index >= 0)
+	{
+		if (game->index < puzzle->count)
+		{
+			puzzle->chars -= puzzle->entries[game->index].size;
+			puzzle->exprs--;
+		}
+		puzzle->resumed = -1;
+		game->index = -1;
+	}
+
+	// wait for the loader if it did not store any expression yet
+	int count;
+	while (!(count = selection_count(puzzle, filter)) && puzzle->loading)
+		pthread_cond_wait(&puzzle->loaded, &puzzle->lock);
+
+	if (!count)
+	{
+		pthread_mutex_unlock(&puzzle->lock);
+		return FAILURE;
+	}
+
+	// get a random word | expression from the pool
+	// and replace it with the last one available
+	PROBE_BEGIN(start);
+	int random_number = selection_draw(puzzle, filter, random_next(&game->seed) % count);
+	pool_remove(puzzle, random_number);
+
+	start_expression(game, puzzle, random_number);
+	PROBE_END(PHASE_START, start);
+	pthread_mutex_unlock(&puzzle->lock);
+	return SUCCESS;
+}
+
+// start a match with a given word | expression of the database
+// (the database is only read, so more games can share it)
+void start_expression(data *game, const vector_string *puzzle, int index)
+{
+	// expressions are not null terminated inside the arena
+	const entry *chosen = &puzzle->entries[index];
+	game_reserve(game, chosen->size);
+	memcpy(game->string, puzzle->arena + chosen->offset, chosen->size);
+	game->string[chosen->size] = '\0';
+
+	// create the new hidden string, the buffers of the last
+	// match are reused
+	index_characters(game, &chosen->letters, &puzzle->glyphs);
+	game->source = &puzzle->glyphs;
+	create_hidden_string(game);
+	game->mistakes[0] = '\0';
+
+	game->stage = 0;
+	game->index = index;
+	game->changed = CHANGED_ALL;
+}
+
+// checksum of a packed database (fnv-1a over words of 8 bytes)
+// hash is 0 at first, or the checksum of the data before
+unsigned long long checksum(const void *data, size_t size, unsigned long long hash)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	if (!hash)
+		hash = 0xCBF29CE484222325ULL;
+
+	size_t index = 0;
+	for (; index + 8 <= size; index += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + index, 8);
+		hash = (hash ^ word) * 0x100000001B3ULL;
+		hash ^= hash >> 32;
+	}
+	for (; index < size; ++index)
+		hash = (hash ^ bytes[index]) * 0x100000001B3ULL;
+	return hash;
+}
+
+// next pseudo random number of a generator (splitmix64)
+// every game has its own state, so games on different threads
+// do not share anything
+unsigned int random_next(unsigned long long *state)
+{
+	unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return (z ^ (z >> 31)) >> 32;
+}
+
+// put every word | expression back in the pool
+void database_reset(vector_string *puzzle)
+{
+	pthread_mutex_lock(&puzzle->lock);
+	puzzle->chars = 0;
+	for (int index = 0; index < puzzle->count; ++index)
+	{
+		puzzle->pool[index] = index;
+		puzzle->places[index].pool = index;
+		puzzle->chars += puzzle->entries[index].size;
+	}
+	for (int index = 0; index < BUCKETS; ++index)
+		puzzle->buckets[index].available = puzzle->buckets[index].count;
+	if (puzzle->chosen)
+		puzzle->chosen->valid = false;
+	if (puzzle->words)
+		memset(puzzle->played, 0, sizeof(unsigned long long) * puzzle->words);
+	puzzle->available = puzzle->count;
+	puzzle->exprs = puzzle->count;
+	pthread_mutex_unlock(&puzzle->lock);
+}
+
+// change the number of files that are still loading; start() waits
+// for them when there is nothing to play yet, and the set of the
+// expressions is let go when none is left
+void database_loading(vector_string *puzzle, int files)
+{
+	pthread_mutex_lock(&puzzle->lock);
+	puzzle->loading += files;
+	if (!puzzle->loading)
+		database_unindex(puzzle);
+	pthread_cond_broadcast(&puzzle->loaded);
+	pthread_mutex_unlock(&puzzle->lock);
+}
+
+// ask the loader to stop at the next line
+void database_cancel(vector_string *puzzle)
+{
+	pthread_mutex_lock(&puzzle->lock);
+	puzzle->cancel = true;
+	pthread_mutex_unlock(&puzzle->lock);
+}
+
+// expressions not played yet in the buckets chosen by filter
+int database_available(vector_string *puzzle, const selection *filter)
+{
+	pthread_mutex_lock(&puzzle->lock);
+	int count = selection_count(puzzle, filter);
+	pthread_mutex_unlock(&puzzle->lock);
+	return count;
+}
+
+// read the counters of the database while it may be loading
+void database_counters(vector_string *puzzle, int *exprs, int *chars)
+{
+	pthread_mutex_lock(&puzzle->lock);
+	*exprs = puzzle->exprs;
+	*chars = puzzle->chars;
+	pthread_mutex_unlock(&puzzle->lock);
+}
+
+// identity of the input files of a database: a snapshot only fits the
+// files it was made with (same files, sizes and modification times)
+unsigned long long snapshot_files(const int *files, int count)
+{
+	unsigned long long hash = 0;
+	for (int index = 0; index < count; ++index)
+	{
+		struct stat info;
+		if (fstat(files[index], &info))
+			continue;
+		unsigned long long fields[5] = {info.st_dev, info.st_ino, info.st_size, info.st_mtim.tv_sec, info.st_mtim.tv_nsec};
+		hash = checksum(fields, sizeof(fields), hash);
+	}
+	return hash;
+}
+
+// write the match of game and the played expressions of puzzle to path;
+// the snapshot is written apart and renamed over the old one, so a
+// crash leaves the old one or the new one, never half of it
+// returns FAILURE if it could not be written
+int snapshot_save(const char *path, const data *game, vector_string *puzzle, unsigned long long files, bool resume)
+{
+	snapshot_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.resume = resume && game->index >= 0;
+	header.files = files;
+	header.index = header.resume ? game->index : -1;
+	header.size = header.resume ? strlen(game->string) : 0;
+	header.score = game->score;
+	header.stage = game->stage;
+	header.seed = game->seed;
+	header.shown = game->shown;
+	header.tried = game->tried;
+	memcpy(header.mistakes, game->mistakes, MISTAKES_SIZE);
+	header.glyphs = game->glyphs;
+
+	char *temporary = (char *) malloc(strlen(path) + 5);
+	if (!temporary)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	sprintf(temporary, "%s.tmp", path);
+	int out = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out < 0)
+	{
+		free(temporary);
+		return FAILURE;
+	}
+
+	// the bitmap is only read here, the lock keeps the loader out
+	pthread_mutex_lock(&puzzle->lock);
+	header.words = puzzle->words;
+	size_t bitmap = sizeof(unsigned long long) * puzzle->words;
+	unsigned long long hash = checksum(&header, sizeof(header), 0);
+	hash = checksum(game->string, header.size, hash);
+	header.checksum = checksum(puzzle->played, bitmap, hash);
+	bool written = write(out, &header, sizeof(header)) == sizeof(header) &&
+		write(out, game->string, header.size) == header.size &&
+		write(out, puzzle->played, bitmap) == (ssize_t) bitmap;
+	pthread_mutex_unlock(&puzzle->lock);
+
+	written = !fsync(out) && written;
+	written = !close(out) && written;
+	if (!written || rename(temporary, path))
+	{
+		unlink(temporary);
+		free(temporary);
+		return FAILURE;
+	}
+	free(temporary);
+	return SUCCESS;
+}
+
+// read the snapshot at path back in game and puzzle: the match is started
+// again as it was and the played expressions are taken out of the pool
+// (now or when they are loaded); a missing snapshot, a broken one or one
+// of other files changes nothing
+// returns FAILURE if nothing was restored
+int snapshot_restore(const char *path, data *game, vector_string *puzzle, unsigned long long files, bool *resume)
+{
+	int in = open(path, O_RDONLY);
+	if (in < 0)
+		return FAILURE;
+
+	struct stat info;
+	snapshot_header header;
+	if (fstat(in, &info) || read(in, &header, sizeof(header)) != sizeof(header) ||
+		memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) || header.version != SNAPSHOT_VERSION ||
+		header.files != files || header.size < 0 || header.words < 0 ||
+		header.glyphs.count < 0 || header.glyphs.count > GLYPHS ||
+		(size_t) info.st_size != sizeof(header) + header.size + sizeof(unsigned long long) * header.words)
+	{
+		close(in);
+		return FAILURE;
+	}
+
+	// the rest of the file is read at once and checked (with the header,
+	// whose checksum is 0 for it) before anything is used
+	size_t bitmap = sizeof(unsigned long long) * header.words;
+	char *rest = (char *) malloc(header.size + bitmap + 1);
+	if (!rest)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	unsigned long long hash = header.checksum;
+	header.checksum = 0;
+	bool valid = read(in, rest, header.size + bitmap) == (ssize_t) (header.size + bitmap) &&
+		checksum(rest + header.size, bitmap, checksum(rest, header.size, checksum(&header, sizeof(header), 0))) == hash;
+	close(in);
+
+	// the match has to be one of the played expressions (the database
+	// may not be loaded yet, the bitmap tells how many there were)
+	if (valid && header.resume)
+	{
+		unsigned long long bits = 0;
+		if (header.index >= 0 && header.index < 64 * header.words)
+			memcpy(&bits, rest + header.size + sizeof(bits) * (header.index >> 6), sizeof(bits));
+		valid = header.size > 0 && header.stage >= 0 && header.stage <= HANGED &&
+			(bits >> (header.index & 63)) & 1;
+	}
+	if (!valid)
+	{
+		free(rest);
+		return FAILURE;
+	}
+
+	// the match is started again from its expression, then the
+	// characters the player found are shown
+	*resume = header.resume;
+	game->score = header.score;
+	game->seed = header.seed;
+	if (*resume)
+	{
+		charset letters;
+		memset(&letters, 0, sizeof(letters));
+		game_reserve(game, header.size);
+		for (int index = 0; index < header.size; ++index)
+		{
+			game->string[index] = rest[index];
+			charset_add(&letters, (unsigned char) rest[index]);
+		}
+		game->string[header.size] = '\0';
+		index_characters(game, &letters, &header.glyphs);
+		create_hidden_string(game);
+		for (int ch = '!'; ch < CHARSET; ++ch)
+			if (charset_has(&header.shown, ch))
+				find_character(game, ch < GLYPH ? ch : header.glyphs.codes[ch - GLYPH]);
+		game->tried = header.tried;
+		memcpy(game->mistakes, header.mistakes, MISTAKES_SIZE);
+		game->mistakes[MISTAKES_SIZE - 1] = '\0';
+		game->stage = header.stage;
+		game->index = header.index;
+		game->changed = CHANGED_ALL;
+	}
+	game->source = &puzzle->glyphs;
+
+	// the played expressions already published go out of the pool now,
+	// the others when they are published
+	pthread_mutex_lock(&puzzle->lock);
+	played_reserve(puzzle, 64 * header.words);
+	puzzle->resumed = *resume ? header.index : -1;
+	for (int word = 0; word < header.words; ++word)
+	{
+		unsigned long long bits;
+		memcpy(&bits, rest + header.size + sizeof(bits) * word, sizeof(bits));
+		bits &= ~puzzle->played[word];
+		puzzle->played[word] |= bits;
+		for (; bits; bits &= bits - 1)
+		{
+			int index = 64 * word + __builtin_ctzll(bits);
+			if (index >= puzzle->count)
+				break;
+			pool_remove(puzzle, index);
+			if (index != puzzle->resumed)
+			{
+				puzzle->chars -= puzzle->entries[index].size;
+				puzzle->exprs--;
+			}
+		}
+	}
+	pthread_mutex_unlock(&puzzle->lock);
+	free(rest);
+	return SUCCESS;
+}
+
+// play a character in the current match
+// returns the same as find_character
+int guess_character(data *game, int ch)
+{
+	// find if character is in the hidden word
+	PROBE_BEGIN(guess);
+	int searcher = find_character(game, ch);
+	PROBE_END(PHASE_GUESS, guess);
+
+	// character found
+	if (searcher == 1)
+	{
+		game->score += ch * searcher;
+		game->changed |= CHANGED_SCORE | CHANGED_HIDDEN;
+	}
+	// character not found
+	else if (searcher == -1)
+	{
+		game->stage++;
+		game->changed |= CHANGED_SCORE | CHANGED_STAGE | CHANGED_MISTAKES;
+		game->score -= ch * searcher;
+
+		// the mistakes are kept as they are shown, in utf-8
+		char shown[4];
+		int bytes = glyph_encode(glyph_upper(ch), shown);
+		int len = strlen(game->mistakes);
+		if (len + bytes + 2 < MISTAKES_SIZE)
+		{
+			memcpy(game->mistakes + len, shown, bytes);
+			memcpy(game->mistakes + len + bytes, ", ", 3);
+		}
+	}
+	return searcher;
+}
+
+// state of the current match: SUCCESS if the expression was guessed,
+// FAILURE if the hangman is complete and RUNNING otherwise
+int game_status(const data *game)
+{
+	if (game->stage >= HANGED)
+		return FAILURE;
+	// an expression can be fully shown from the start (ex: "aa")
+	if (charset_empty(&game->secret))
+		return SUCCESS;
+	return RUNNING;
+}
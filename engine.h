@@ -0,0 +1,400 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// the game engine: the word | expression database and the rules of a
+// match, without any terminal code, so it can be used by the console
+// game and by the tools that play games at machine speed
+
+// useful constant for the game logic
+// statuses returned by a game state
+#define FAILURE 0xFFFFFFFF
+#define SUCCESS 0
+#define RUNNING 2
+// first length of the buffers (they grow with the expressions)
+#define BUFLEN 1000
+#define STRING_SIZE 100
+// max number of mistakes in a match, each one takes up to 6 bytes
+// ("X, " with X in utf-8) in the mistakes table
+#define MISTAKES 7
+#define MISTAKES_SIZE (6 * MISTAKES + 1)
+// stage of the hangman when the match is lost
+#define HANGED 6
+// number of characters a charset can hold: the ascii ones, then the
+// characters of the database that are not ascii (see alphabet)
+#define CHARSET 256
+#define GLYPH 128
+#define GLYPHS (CHARSET - GLYPH)
+// expressions stored before they are published to the players
+#define BATCH 4096
+// packed database format (made by hangman-pack)
+#define PACK_MAGIC "HANGPACK"
+#define PACK_VERSION 4
+// snapshot of a session (the match and the expressions played)
+#define SNAPSHOT_MAGIC "HANGSNAP"
+#define SNAPSHOT_VERSION 3
+// buckets of the database by length, words and distinct characters of
+// the expressions; the last bucket of each one holds all the larger ones
+// (a filter that only takes some of them keeps the ones that fit apart)
+#define BUCKET_LENGTHS 32
+#define BUCKET_WORDS 8
+#define BUCKET_DISTINCT 16
+#define BUCKETS (BUCKET_LENGTHS * BUCKET_WORDS * BUCKET_DISTINCT)
+// parts of a game changed since they were last shown
+#define CHANGED_SCORE 1
+#define CHANGED_HIDDEN 2
+#define CHANGED_MISTAKES 4
+#define CHANGED_STAGE 8
+#define CHANGED_ALL 15
+
+// set of characters, one bit for each of them
+typedef struct charset
+{
+	unsigned long long bits[CHARSET / 64];
+} charset;
+
+// charset operations, all of them are constant time
+static inline void charset_add(charset *set, int ch)
+{
+	set->bits[ch >> 6] |= 1ULL << (ch & 63);
+}
+
+static inline void charset_remove(charset *set, int ch)
+{
+	set->bits[ch >> 6] &= ~(1ULL << (ch & 63));
+}
+
+static inline bool charset_has(const charset *set, int ch)
+{
+	return (set->bits[ch >> 6] >> (ch & 63)) & 1;
+}
+
+static inline bool charset_empty(const charset *set)
+{
+	return !(set->bits[0] | set->bits[1] | set->bits[2] | set->bits[3]);
+}
+
+// how a character is shown in the hidden string: the ascii letters
+// become capital letters, the others are kept (see glyph_upper)
+static inline int charset_shown(int ch)
+{
+	return ch >= 'a' && ch <= 'z' ? ch - 'a' + 'A' : ch;
+}
+
+// the characters that are not ascii: the expressions are decoded from
+// utf-8 once, when they are loaded, and keep one byte for each character,
+// GLYPH + n for the n-th code point here; they are found by code point
+// in a table (open addressing, code point << 8 | n, 0 for an empty slot)
+// that is read while the loader adds to it, so the slots are atomic
+typedef struct alphabet
+{
+	// code point of each character (the small letter)
+	int codes[GLYPHS];
+	// characters added (the slots used)
+	int count;
+	// (the size stays a multiple of 8, the entries after it in a packed
+	// file are used in place)
+	int padding;
+	unsigned int table[2 * GLYPHS];
+} alphabet;
+
+// current game data
+typedef struct data
+{
+	// string that represent the word | expression
+	// that need to be guessed
+	char *string;
+	// hidden string that is printed to the player
+	char *hidden;
+	// array of characters that were tried and represent
+	// mistakes (in utf-8)
+	char *mistakes;
+	// characters that string, hidden and next can hold
+	int length;
+	// characters that still need to be guessed, characters
+	// already shown and characters tried as mistakes
+	charset secret;
+	charset shown;
+	charset tried;
+	// positions of each character in the string: first[ch] is the
+	// first one, next[position] the one after it (-1 ends the list)
+	int first[CHARSET];
+	int *next;
+	// the characters of the expression that are not ascii, and the
+	// alphabet of the database for the other ones
+	alphabet glyphs;
+	const alphabet *source;
+	// score
+	int score;
+	// stage of the drawn hangman
+	int stage;
+	// index of the expression in the database
+	int index;
+	// state of the random number generator of the game
+	unsigned long long seed;
+	// CHANGED_* flags, cleared by whoever shows the game
+	int changed;
+} data;
+
+// position of a word | expression inside the database arena
+typedef struct entry
+{
+	// offset of the first character in the arena
+	size_t offset;
+	// number of characters (expressions are not null terminated)
+	int size;
+	// hash of the characters, to find the same expression again
+	unsigned int hash;
+	// number of words (the spaces and one) and bucket of the expression,
+	// found when it is stored
+	int words;
+	int bucket;
+	// all the characters used in the expression
+	charset letters;
+} entry;
+
+// a slot of the set of expressions: the hash and the index of an
+// expression plus one (0 for an empty slot)
+typedef struct bin
+{
+	unsigned int hash;
+	int index;
+} bin;
+
+// where an expression is in the pool, in the members of its bucket and
+// in the part of its bucket chosen by the last filter (see choice)
+typedef struct place
+{
+	int pool;
+	int bucket;
+	int member;
+	int part;
+} place;
+
+// expressions with the same length, words and distinct characters: the
+// first available ones are not played yet (a used one is swapped with
+// the last available, so it stays in the bucket for the next reset)
+typedef struct bucket
+{
+	int *members;
+	int available;
+	int count;
+	int capacity;
+} bucket;
+
+// the buckets a match can be chosen from: a minimum and a maximum of
+// each of them (included, 0 for no bound)
+typedef struct selection
+{
+	int length[2];
+	int words[2];
+	int distinct[2];
+} selection;
+
+// the buckets of the last filter a match was drawn from: the groups are
+// the buckets it takes, a last bucket it only takes a part of keeps the
+// available members that fit it in parts, and tree is a fenwick tree of
+// the available expressions of every group, so a count takes one step
+// and a draw log(BUCKETS) of them
+typedef struct choice
+{
+	selection filter;
+	bool valid;
+	int groups;
+	int total;
+	// group of each bucket (-1 if it is not chosen) and bucket of each group
+	int group[BUCKETS];
+	int buckets[BUCKETS];
+	bool partial[BUCKETS];
+	bucket parts[BUCKETS];
+	int tree[BUCKETS + 1];
+} choice;
+
+// a packed database file is this header, the alphabet and the entries
+// of the database (in the byte order of the machine) and then the arena;
+// the checksum covers everything after the header
+typedef struct pack_header
+{
+	char magic[8];
+	unsigned int version;
+	int count;
+	unsigned long long bytes;
+	unsigned long long checksum;
+} pack_header;
+
+// a snapshot file is this header, the expression of the match and a
+// bitmap of the expressions taken out of the pool (one bit for each,
+// in words of 64 bits); it is only valid for the same input files
+typedef struct snapshot_header
+{
+	char magic[8];
+	unsigned int version;
+	// the match can be resumed
+	bool resume;
+	// identity of the input files (see snapshot_files)
+	unsigned long long files;
+	// the match: its expression (size characters after the header, -1
+	// for no match) and what the player did
+	int index;
+	int size;
+	int score;
+	int stage;
+	unsigned long long seed;
+	charset shown;
+	charset tried;
+	char mistakes[MISTAKES_SIZE];
+	// code points of the characters of the match that are not ascii
+	alphabet glyphs;
+	// words of the bitmap and checksum of the header (with a checksum of
+	// 0) and of everything after it
+	int words;
+	unsigned long long checksum;
+} snapshot_header;
+
+// files stored at the same time (see database_store_files)
+typedef struct loading_files
+{
+	struct vector_string *vec;
+	const int *files;
+	int count;
+	// next file to parse, a database for each file, if it is parsed
+	// and if it could not be parsed
+	int next;
+	struct vector_string **parts;
+	bool *parsed;
+	bool *broken;
+	// the threads stop taking files when stop is set
+	bool stop;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+} loading_files;
+
+// database of words | expressions for the game
+typedef struct vector_string
+{
+	// all the words | expressions, one after another
+	char *arena;
+	// bytes used and reserved in the arena
+	size_t used;
+	size_t capacity;
+	// where every word | expression is in the arena
+	entry *entries;
+	// indexes of the entries not played yet, the first
+	// available ones (a used one is swapped with the last)
+	int *pool;
+	int available;
+	// the same expressions by bucket, and where each one of them is
+	place *places;
+	bucket *buckets;
+	// the last filter matches were drawn from (made when one is used)
+	choice *chosen;
+	// number of words in the database (used when database is loaded)
+	int count;
+	// number of words in the database
+	int exprs;
+	// dimensions of words (used when database is loaded)
+	int dim;
+	int chars;
+	// the database can be played while it is loaded: lock guards the
+	// fields above (except the arena bytes and entries past count, that
+	// only the loader touches), loaded is signaled for every batch
+	pthread_mutex_t lock;
+	pthread_cond_t loaded;
+	// files still loading, and if the loading should stop (checked
+	// every batch)
+	int loading;
+	bool cancel;
+	// a file parsed apart to be added to another database later: its
+	// expressions are only counted (and hashed), nobody plays them
+	bool staging;
+	// every expression once, by hash (open addressing, only used by the
+	// loader) and the expressions and characters left out as duplicates;
+	// the first unindexed expressions (a packed database, or all of them
+	// once the loading is over and the set is let go) are not in the set
+	// until another expression is added
+	bin *set;
+	size_t bins;
+	int unindexed;
+	int duplicates;
+	size_t duplicated;
+	// files left out because their characters did not fit in the
+	// alphabet with the ones of the files before them
+	int overflows;
+	// the characters of the expressions that are not ascii
+	alphabet glyphs;
+	// expressions taken out of the pool, one bit each; a snapshot can
+	// set bits past count, they are taken out when they are published
+	// (except resumed, the match of the snapshot, that is still counted)
+	unsigned long long *played;
+	int words;
+	int resumed;
+	// a packed database file used in place as arena and entries
+	// (copied to the heap if the database has to grow)
+	char *mapping;
+	size_t mapped;
+} vector_string;
+
+// guessing strategy used to play without a player: returns the
+// character to try next in the current match of game
+typedef int (*strategy)(const data *game, void *state);
+
+// create and destroy the engine data
+data *game_create();
+void game_destroy(data *game);
+void game_reserve(data *game, int size);
+vector_string *database_create();
+void database_destroy(vector_string *puzzle);
+
+// database functions
+void alocator(vector_string *v);
+void arena_reserve(vector_string *v, size_t bytes);
+int expression_store(int source, vector_string *expr);
+int pack_store(int source, vector_string *vec);
+int database_store(int source, vector_string *vec);
+int database_check(int source);
+int database_store_files(vector_string *vec, const int *files, int count, int threads);
+void database_append(vector_string *vec, const entry *entries, int count, const char *arena, size_t bytes, const alphabet *glyphs);
+void database_detach(vector_string *vec);
+void database_reset(vector_string *puzzle);
+void database_loading(vector_string *puzzle, int files);
+void database_cancel(vector_string *puzzle);
+void database_counters(vector_string *puzzle, int *exprs, int *chars);
+int database_insert(vector_string *vec, const char *string, int size, unsigned int hash, int index);
+bool publish(vector_string *vec, int count);
+
+// snapshot functions
+unsigned long long snapshot_files(const int *files, int count);
+int snapshot_save(const char *path, const data *game, vector_string *puzzle, unsigned long long files, bool resume);
+int snapshot_restore(const char *path, data *game, vector_string *puzzle, unsigned long long files, bool *resume);
+
+// match functions
+int start(data *game, vector_string *puzzle);
+int start_selection(data *game, vector_string *puzzle, const selection *filter);
+int database_available(vector_string *puzzle, const selection *filter);
+void start_expression(data *game, const vector_string *puzzle, int index);
+int guess_character(data *game, int ch);
+int game_status(const data *game);
+
+// util functions
+int  clean_for_print(char *s, int size, alphabet *glyphs);
+void create_hidden_string(data *game);
+void index_characters(data *game, const charset *letters, const alphabet *glyphs);
+int find_character(data *game, int ch);
+
+// character functions (code points of unicode)
+int glyph_find(const alphabet *glyphs, int code);
+int glyph_add(alphabet *glyphs, int code);
+int glyph_code(const data *game, int ch);
+int glyph_lower(int code);
+int glyph_upper(int code);
+int glyph_width(int code);
+int glyph_decode(const char *text, int size, int *code);
+int glyph_encode(int code, char *text);
+int glyph_text(const alphabet *glyphs, const char *string, int size, char *text, bool upper);
+unsigned int random_next(unsigned long long *state);
+unsigned long long checksum(const void *data, size_t size, unsigned long long hash);
+
+#endif
@@ -0,0 +1,638 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "engine.h"
+
+// hangman-fuzz: the rules of a match without a terminal, run with:
+// make fuzz
+// the replay files have a recorded match on each line, the expression,
+// the keys typed (in utf-8, a backspace leaves the match) and how the
+// match ended, separated by tabs: the status, the score, the stage and
+// the hidden string ("running 352 2 B_N_NA"), or "-" for an expression
+// that is cleaned to nothing;
+// then random lines are made from a few seeds, cleaned like the input
+// files and played with random keys for some seconds
+//
+// after every step the game is checked (hidden string, mistakes, stage)
+// and every input is timed; a broken check or a crash prints the input
+// that caused it, the slowest inputs are printed at the end
+
+// longest input line made by the fuzzer
+#define LINE 128
+// inputs kept to be mutated again
+#define CORPUS 4096
+// slowest inputs reported
+#define SLOWEST 8
+// timing histogram: buckets of 8 nanoseconds, the last one holds the
+// slower inputs
+#define TIMES 4096
+#define TIME_STEP 8
+
+// an input and how long it took
+typedef struct sample
+{
+	unsigned long long ns;
+	int size;
+	unsigned char bytes[LINE];
+} sample;
+
+// declaration of the functions used by the harness
+void replay(const char *path, data *game);
+void fuzz(data *game, unsigned long long seed, double seconds, long inputs);
+int mutate(unsigned char *input, int size, unsigned long long *rng);
+int play(data *game, const unsigned char *input, int size, const unsigned char *keys, int count, bool checked);
+void setup(data *game, const char *string, int size);
+void outcome(const data *game, int written, char *text);
+int clean_reference(const char *string, int size, char *cleaned);
+void check_line(const char *line, int size);
+void check(const data *game, bool full);
+void fail(const char *what);
+void crash(int signal);
+void record(const unsigned char *input, int size, unsigned long long ns);
+void summary(const char *name, double seconds);
+void print_input(FILE *out, const unsigned char *input, int size);
+char *grow(char *buffer, size_t *capacity, size_t size);
+unsigned long long now();
+
+// input running now (its start), printed if it crashes
+unsigned char current[2 * LINE];
+volatile int current_size;
+// timing of the inputs of the current run
+unsigned long long times[TIMES];
+unsigned long long total;
+// the characters that are not ascii of the inputs, like the ones of a
+// database (the fuzzer starts again when it is full)
+alphabet glyphs;
+// buffers of the lines played and of their outcomes, on the heap (a
+// replayed line can be of any length); they grow with the longest one
+char *cleaned, *reference, *ended;
+size_t cleaned_size, reference_size, ended_size;
+long runs;
+sample slowest[SLOWEST];
+
+// the main function of the harness
+int main(int argc, char *const argv[])
+{
+	double seconds = 5;
+	long inputs = 0;
+	unsigned long long seed = time(NULL);
+
+	int option;
+	while ((option = getopt(argc, argv, "t:n:s:")) != -1)
+	{
+		switch (option)
+		{
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 'n':
+			inputs = atol(optarg);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman-fuzz [-t <seconds> | -n <inputs>] [-s <seed>] [<replay-file-1> ...]\n\n");
+			return FAILURE;
+		}
+	}
+
+	// a crash prints the input first
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = crash;
+	action.sa_flags = SA_RESETHAND;
+	sigaction(SIGSEGV, &action, NULL);
+	sigaction(SIGBUS, &action, NULL);
+	sigaction(SIGFPE, &action, NULL);
+	sigaction(SIGABRT, &action, NULL);
+
+	data *game = game_create();
+	for (int index = optind; index < argc; ++index)
+		replay(argv[index], game);
+
+	printf("seed: %llu\n", seed);
+	fuzz(game, seed, seconds, inputs);
+
+	game_destroy(game);
+	free(cleaned);
+	free(reference);
+	free(ended);
+	return SUCCESS;
+}
+
+// play the recorded matches of a file, then start() every one of them
+// until the database is empty
+void replay(const char *path, data *game)
+{
+	FILE *in = fopen(path, "r");
+	if (!in)
+	{
+		fprintf(stderr, "[Error] File %s failed to open\n\n", path);
+		exit(FAILURE);
+	}
+
+	// the cleaned expressions are kept to make a database of them
+	char *arena = NULL;
+	entry *entries = NULL;
+	size_t used = 0;
+	int count = 0;
+
+	memset(times, 0, sizeof(times));
+	memset(slowest, 0, sizeof(slowest));
+	total = runs = 0;
+	unsigned long long begin = now();
+
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t read;
+	while ((read = getline(&line, &capacity, in)) > 0)
+	{
+		if (line[read - 1] == '\n')
+			line[--read] = '\0';
+		char *keys = memchr(line, '\t', read);
+		char *expected = keys ? memchr(keys + 1, '\t', line + read - keys - 1) : NULL;
+		int size = keys ? keys - line : read;
+		int typed = expected ? expected - keys - 1 : 0;
+		if (!expected)
+		{
+			fprintf(stderr, "[Error] Could not parse the file %s\n\n", path);
+			exit(FAILURE);
+		}
+
+		// it is timed first, then played again with the checks
+		unsigned long long start = now();
+		play(game, (unsigned char *) line, size, (unsigned char *) (keys ? keys + 1 : ""), typed, false);
+		record((unsigned char *) line, size, now() - start);
+		int written = play(game, (unsigned char *) line, size, (unsigned char *) keys + 1, typed, true);
+
+		// the match has to end as it was recorded
+		ended = grow(ended, &ended_size, 4 * (size_t) size + 32);
+		outcome(game, written, ended);
+		if (strcmp(ended, expected + 1))
+		{
+			size_t length = strlen(ended) + 64;
+			char *what = grow(NULL, &length, length);
+			sprintf(what, "the match ended as \"%s\", not as recorded", ended);
+			fail(what);
+		}
+		if (!written)
+			continue;
+
+		char *aux = (char *) realloc(arena, used + written);
+		entry *eaux = (entry *) realloc(entries, sizeof(entry) * (count + 1));
+		if (!aux || !eaux)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		arena = aux;
+		entries = eaux;
+		memcpy(arena + used, game->string, written);
+		entries[count].offset = used;
+		entries[count].size = written;
+		entries[count].hash = checksum(game->string, written, 0);
+		entries[count].words = 1;
+		memset(&entries[count].letters, 0, sizeof(charset));
+		for (int index = 0; index < written; ++index)
+		{
+			charset_add(&entries[count].letters, (unsigned char) game->string[index]);
+			entries[count].words += game->string[index] == ' ';
+		}
+		used += written;
+		count++;
+	}
+	free(line);
+	fclose(in);
+	summary(path, (now() - begin) / 1e9);
+
+	// every expression is started once, then start() has to fail
+	vector_string *puzzle = database_create();
+	database_append(puzzle, entries, count, arena, used, &glyphs);
+	int started = 0;
+	while (started <= puzzle->count && start(game, puzzle) == SUCCESS)
+		started++;
+	if (started != puzzle->count)
+		fail("start() did not play every expression once");
+	printf("%s: %d expressions started\n", path, started);
+
+	database_destroy(puzzle);
+	free(entries);
+	free(arena);
+}
+
+// play random inputs for some seconds (or some inputs): every one of
+// them is a mutation of an input kept before, the ones that end in a
+// result not seen yet (length, words, status) are kept too
+void fuzz(data *game, unsigned long long seed, double seconds, long inputs)
+{
+	static unsigned char corpus[CORPUS][LINE];
+	static int sizes[CORPUS];
+	static bool seen[LINE][8][3];
+	int kept = 0;
+
+	// the seeds: a word, a few expressions and the lines that are
+	// known to be the hardest ones
+	const char *seeds[] = {"banana", "the quick brown fox", "a b c d e f g", "  spaces   between  words  ",
+		"MiXeD CaSe\tand\ttabs", "x", "\xff\xfe\x01 control \x7f bytes \x80", "\xc3\x8e" "nghe\xc8\x9b" "at\xc4\x83 STRA\xc3\x9f" "E",
+		"\xce\xba\xce\xb1\xce\xbb\xce\xb7\xce\xbc\xce\xad\xcf\x81\xce\xb1 \xce\x9a\xce\x8c\xce\xa3\xce\x9c\xce\x95",
+		"\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\xc2\xa0" "a\xcc\x81", "\xc3\x28 \xe2\x82 \xf0\x9f\x98 \xed\xa0\x80 \xc0\xaf"};
+	for (int index = 0; index < (int) (sizeof(seeds) / sizeof(seeds[0])); ++index)
+	{
+		sizes[kept] = strlen(seeds[index]);
+		memcpy(corpus[kept], seeds[index], sizes[kept]);
+		kept++;
+	}
+	sizes[kept] = 99;
+	memset(corpus[kept++], ' ', 99);
+	sizes[kept] = 99;
+	memset(corpus[kept++], 'q', 99);
+	sizes[kept] = LINE - 1;
+	for (int index = 0; index < LINE - 1; ++index)
+		corpus[kept][index] = index % 2 ? ' ' : 'a' + index % 26;
+	kept++;
+
+	memset(times, 0, sizeof(times));
+	memset(slowest, 0, sizeof(slowest));
+	total = runs = 0;
+	unsigned long long rng = seed;
+	unsigned long long begin = now();
+	unsigned long long limit = begin + seconds * 1e9;
+
+	unsigned char input[LINE], keys[32];
+	for (long done = 0; inputs ? done < inputs : (done & 1023) || now() < limit; ++done)
+	{
+		int chosen = random_next(&rng) % kept;
+		memcpy(input, corpus[chosen], sizes[chosen]);
+		int size = mutate(input, sizes[chosen], &rng);
+
+		// the keys are characters of the input (the utf-8 ones whole)
+		// or any byte
+		int wanted = 1 + random_next(&rng) % sizeof(keys), count = 0;
+		while (count < wanted)
+		{
+			unsigned int random = random_next(&rng);
+			int at = size ? (random >> 1) % size : 0, code;
+			int length = size && random & 1 ? glyph_decode((char *) input + at, size - at, &code) : 0;
+			if (length && count + length <= (int) sizeof(keys))
+			{
+				memcpy(keys + count, input + at, length);
+				count += length;
+			}
+			else
+				keys[count++] = random >> 8;
+		}
+
+		// the alphabet only grows, a full one takes every new character out
+		if (glyphs.count == GLYPHS)
+			memset(&glyphs, 0, sizeof(glyphs));
+
+		unsigned long long start = now();
+		play(game, input, size, keys, count, false);
+		unsigned long long ns = now() - start;
+		// a slow input is timed again, a preemption is not a cliff
+		for (int again = 0; again < 3 && ns > slowest[SLOWEST - 1].ns; ++again)
+		{
+			start = now();
+			play(game, input, size, keys, count, false);
+			ns = now() - start < ns ? now() - start : ns;
+		}
+		record(input, size, ns);
+		int written = play(game, input, size, keys, count, true);
+
+		// a new kind of result is kept to be mutated again
+		int words = 1;
+		for (int index = 0; index < written; ++index)
+			words += game->string[index] == ' ';
+		int status = game_status(game);
+		bool *shape = &seen[written][words < 8 ? words : 7][status == RUNNING ? 0 : status == SUCCESS ? 1 : 2];
+		if (!*shape)
+		{
+			*shape = true;
+			int slot = kept < CORPUS ? kept++ : random_next(&rng) % CORPUS;
+			memcpy(corpus[slot], input, size);
+			sizes[slot] = size;
+		}
+	}
+	summary("fuzz", (now() - begin) / 1e9);
+}
+
+// change an input in a few random places
+// returns its new size
+int mutate(unsigned char *input, int size, unsigned long long *rng)
+{
+	static const unsigned char special[] = " \t\n\r\x01\x7f\x80\xff\xc3\xce\xe2\xf0~AZaz";
+	int changes = 1 + random_next(rng) % 4;
+	for (int change = 0; change < changes; ++change)
+	{
+		unsigned int random = random_next(rng);
+		int at = size ? (random >> 8) % size : 0;
+		unsigned char byte = random & 0x10 ? special[(random >> 5) % (sizeof(special) - 1)] : random >> 24;
+		switch (random % 6)
+		{
+		// change a character
+		case 0:
+			if (size)
+				input[at] = byte;
+			break;
+		// add a character
+		case 1:
+			if (size < LINE - 1)
+			{
+				memmove(input + at + 1, input + at, size - at);
+				input[at] = byte;
+				size++;
+			}
+			break;
+		// take a character out
+		case 2:
+			if (size)
+			{
+				memmove(input + at, input + at + 1, size - at - 1);
+				size--;
+			}
+			break;
+		// repeat the character to the end
+		case 3:
+			if (size)
+			{
+				int end = at + 1 + (random >> 16) % (LINE - 1 - at);
+				memset(input + at, input[at], end - at);
+				size = end > size ? end : size;
+			}
+			break;
+		// cut the end
+		case 4:
+			size = at;
+			break;
+		// spaces over a part
+		case 5:
+			memset(input + at, ' ', (random >> 4) % (size - at + 1));
+			break;
+		}
+	}
+	return size;
+}
+
+// clean an input like a line of an input file, play it with the keys the
+// way run() does and (if checked) check the game after every one of them
+// returns the size of the cleaned expression (0 if nothing was played)
+int play(data *game, const unsigned char *input, int size, const unsigned char *keys, int count, bool checked)
+{
+	current_size = size < (int) sizeof(current) ? size : (int) sizeof(current);
+	memcpy(current, input, current_size);
+
+	// without an alphabet the cleaned line has to be the same as a plain
+	// byte by byte one, with it the utf-8 characters are decoded too
+	char *line = cleaned = grow(cleaned, &cleaned_size, size + 1);
+	reference = grow(reference, &reference_size, size + 1);
+	int written;
+	if (checked)
+	{
+		memcpy(line, input, size);
+		written = clean_for_print(line, size, NULL);
+		if (written != clean_reference((const char *) input, size, reference) || memcmp(line, reference, written))
+			fail("clean_for_print() is not the same as the reference");
+	}
+	memcpy(line, input, size);
+	written = clean_for_print(line, size, &glyphs);
+	if (checked && written > 0)
+		check_line(line, written);
+	if (written <= 0)
+		return 0;
+
+	setup(game, line, written);
+	if (checked)
+		check(game, true);
+	for (int index = 0; index < count && game_status(game) == RUNNING; ++index)
+	{
+		// a backspace leaves the match
+		if (keys[index] == '\b' || keys[index] == 0x7F)
+			break;
+		int code, length;
+		if (isprint(keys[index]))
+			guess_character(game, keys[index]);
+		else if (keys[index] >= 0x80 && (length = glyph_decode((const char *) keys + index, count - index, &code)))
+		{
+			guess_character(game, code);
+			index += length - 1;
+		}
+		if (checked)
+			check(game, false);
+	}
+	// the shown positions only change to shown, so a wrong one is
+	// still there at the end
+	if (checked)
+		check(game, true);
+	return written;
+}
+
+// start a match with an expression, like start_expression() does with
+// one of the database
+void setup(data *game, const char *string, int size)
+{
+	charset letters;
+	memset(&letters, 0, sizeof(letters));
+	game_reserve(game, size);
+	memcpy(game->string, string, size);
+	game->string[size] = '\0';
+	for (int index = 0; index < size; ++index)
+		charset_add(&letters, (unsigned char) string[index]);
+
+	index_characters(game, &letters, &glyphs);
+	game->source = &glyphs;
+	create_hidden_string(game);
+	game->mistakes[0] = '\0';
+	game->stage = 0;
+	game->score = 0;
+}
+
+// how a match ended: its status, score, stage and hidden string (in
+// utf-8), "-" if nothing was played; text needs 4 bytes for each
+// character of the expression and 32 more
+void outcome(const data *game, int written, char *text)
+{
+	if (!written)
+	{
+		strcpy(text, "-");
+		return;
+	}
+	int status = game_status(game);
+	int length = sprintf(text, "%s %d %d ", status == SUCCESS ? "won" : status == FAILURE ? "lost" : "running",
+		game->score, game->stage);
+	glyph_text(&game->glyphs, game->hidden, strlen(game->hidden), text + length, true);
+}
+
+// the cleaning done one character at a time: only printable characters,
+// lowercase, one space between words and none at the ends
+int clean_reference(const char *string, int size, char *cleaned)
+{
+	int written = 0;
+	for (int index = 0; index < size; ++index)
+	{
+		unsigned char ch = string[index];
+		if (!isprint(ch))
+			continue;
+		if (ch == ' ' && (!written || cleaned[written - 1] == ' '))
+			continue;
+		cleaned[written++] = tolower(ch);
+	}
+	if (written && cleaned[written - 1] == ' ')
+		written--;
+	return written;
+}
+
+// a cleaned line only has printable ascii characters (no capital
+// letters) and characters of the alphabet, with one space between words
+void check_line(const char *line, int size)
+{
+	for (int index = 0; index < size; ++index)
+	{
+		int ch = (unsigned char) line[index];
+		if (ch == ' ' && (!index || index == size - 1 || line[index - 1] == ' '))
+			fail("the cleaned line has spaces at the ends or more of them together");
+		if (ch < GLYPH ? !isprint(ch) || isupper(ch) : ch >= GLYPH + glyphs.count)
+			fail("the cleaned line has a character that is not printable");
+		if (ch >= GLYPH && (glyph_lower(glyphs.codes[ch - GLYPH]) != glyphs.codes[ch - GLYPH] || !glyph_width(glyphs.codes[ch - GLYPH])))
+			fail("the alphabet has a character that is not a printable small letter");
+	}
+}
+
+// the state of the game has to follow from its string and charsets
+// (full also checks the hidden string, that takes a pass over it)
+void check(const data *game, bool full)
+{
+	if (game->stage < 0 || game->stage > HANGED)
+		fail("the stage is out of the hangman");
+	if (strnlen(game->mistakes, MISTAKES_SIZE) >= MISTAKES_SIZE)
+		fail("the mistakes table overflowed");
+	if (!full)
+		return;
+
+	bool hidden = false;
+	int index = 0;
+	for (; game->string[index]; ++index)
+	{
+		int ch = (unsigned char) game->string[index];
+		int expected = ch == ' ' ? ' ' : charset_has(&game->secret, ch) ? '_' : charset_shown(ch);
+		if ((unsigned char) game->hidden[index] != expected)
+			fail("the hidden string does not match the expression");
+		// (an underscore of the expression is shown as itself)
+		hidden |= ch != ' ' && charset_has(&game->secret, ch);
+	}
+	if (game->hidden[index])
+		fail("the hidden string is longer than the expression");
+	if ((game_status(game) == SUCCESS) == hidden)
+		fail("the status does not match the hidden string");
+}
+
+// report a broken check and the input that caused it
+void fail(const char *what)
+{
+	fprintf(stderr, "[Error] %s, input: ", what);
+	print_input(stderr, current, current_size);
+	fprintf(stderr, "\n");
+	exit(FAILURE);
+}
+
+// make a buffer of capacity bytes hold size bytes (a new one for NULL)
+// returns the buffer, it may have moved
+char *grow(char *buffer, size_t *capacity, size_t size)
+{
+	if (buffer && size <= *capacity)
+		return buffer;
+	char *aux = (char *) realloc(buffer, size);
+	if (!aux)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	*capacity = size;
+	return aux;
+}
+
+// print the input that crashed (only with what a signal handler can use)
+void crash(int signal)
+{
+	static const char digits[] = "0123456789abcdef";
+	char text[sizeof("[Error] Crashed, input (hex): \n") + 2 * sizeof(current)] = "[Error] Crashed, input (hex): ";
+	int length = strlen(text);
+	for (int index = 0; index < current_size; ++index)
+	{
+		text[length++] = digits[current[index] >> 4];
+		text[length++] = digits[current[index] & 15];
+	}
+	text[length++] = '\n';
+	write(STDERR_FILENO, text, length);
+	raise(signal);
+}
+
+// add the time of an input to the histogram and to the slowest ones
+void record(const unsigned char *input, int size, unsigned long long ns)
+{
+	unsigned long long bucket = ns / TIME_STEP;
+	times[bucket < TIMES ? bucket : TIMES - 1]++;
+	total += ns;
+	runs++;
+
+	if (ns <= slowest[SLOWEST - 1].ns)
+		return;
+	int index = SLOWEST - 1;
+	for (; index > 0 && slowest[index - 1].ns < ns; --index)
+		slowest[index] = slowest[index - 1];
+	slowest[index].ns = ns;
+	slowest[index].size = size < LINE ? size : LINE;
+	memcpy(slowest[index].bytes, input, slowest[index].size);
+}
+
+// print the inputs per second, the percentiles and the slowest inputs
+void summary(const char *name, double seconds)
+{
+	unsigned long long seen = 0, percentiles[2] = {0, 0};
+	for (int bucket = 0; bucket < TIMES; ++bucket)
+	{
+		seen += times[bucket];
+		if (!percentiles[0] && seen > runs * 0.50)
+			percentiles[0] = (bucket + 1) * TIME_STEP;
+		if (!percentiles[1] && seen > runs * 0.99)
+			percentiles[1] = (bucket + 1) * TIME_STEP;
+	}
+
+	printf("%s: %ld inputs in %.3f s (%.0f per second), mean %.0f ns, p50 < %llu ns, p99 < %llu ns\n", name, runs, seconds,
+		runs / seconds, runs ? (double) total / runs : 0, percentiles[0], percentiles[1]);
+	for (int index = 0; index < SLOWEST && slowest[index].ns; ++index)
+	{
+		printf("  %8llu ns  ", slowest[index].ns);
+		print_input(stdout, slowest[index].bytes, slowest[index].size);
+		printf("\n");
+	}
+}
+
+// print an input as a c string
+void print_input(FILE *out, const unsigned char *input, int size)
+{
+	fprintf(out, "\"");
+	for (int index = 0; index < size; ++index)
+	{
+		if (input[index] == '"' || input[index] == '\\')
+			fprintf(out, "\\%c", input[index]);
+		else if (isprint(input[index]))
+			fprintf(out, "%c", input[index]);
+		else
+			fprintf(out, "\\x%02x", input[index]);
+	}
+	fprintf(out, "\" (%d)", size);
+}
+
+// nanoseconds of the monotonic clock
+unsigned long long now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -2,65 +2,44 @@
 #include <stdlib.h>
 #include <ncurses.h>
 #include <ctype.h>
+#include <wctype.h>
+#include <locale.h>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 
-// useful constant for the game logic
-// statuses returned by a game state
-#define FAILURE 0xFFFFFFFF
-#define SUCCESS 0
-#define RUNNING 2
-// console window size
-#define ROWS 35
-#define COLS 120
-// max length of buffers and expressions
-#define BUFLEN 1000
-#define STRING_SIZE 100
-// max number of mistakes in a match
-#define MISTAKES 7
-
-// enum that maps the main menu buttons
+#include "engine.h"
+#include "probe.h"
+#include "screen.h"
+
+// milliseconds between two clock updates
+#define TICK 1000
+
+// enum that maps the main menu buttons (one under the other from
+// area.buttons_row)
 typedef enum button
 {
-	NEW = 13,
-	RESUME = 14,
-	QUIT = 15
+	NEW,
+	RESUME,
+	QUIT
 } button;
 
-// current game data
-typedef struct data
-{
-	// string that represent the word | expression
-	// that need to be guessed
-	char *string;
-	// hidden string that is printed to the player
-	char *hidden;
-	// array of characters that were tried and represent
-	// mistakes
-	char *mistakes;
-	// score
-	int score;
-	// stage of the drawn hangman
-	int stage;
-	// index of the expression in the database
-	int index;
-} data;
-
-// database of words | expressions for the game
-typedef struct vector_string
+// names of the main menu buttons
+const char buttons[3][12] = {"New Game", "Resume Game", "Quit"};
+
+// input files that are loaded while the game is already running, the
+// one that could not be parsed (-1 for none) and the ones left out
+// because the alphabet was full (both set by the loader)
+typedef struct loader
 {
-	// all the words } expresiions
-	char **expressions;
-	// all their size
-	int *sizes;
-	// number of words in the database (used when database is loaded)
+	int *files;
+	char *const *names;
 	int count;
-	// number of words in the database
-	int exprs;
-	// dimensions of words (used when database is loaded)
-	int dim;
-	int chars;
-} vector_string;
+	int failed;
+	int overflows;
+	pthread_t thread;
+} loader;
 
 // global varialbe used for storing data about the game
 // can be the game resumed or not
@@ -69,82 +48,122 @@ bool resume;
 data *game;
 // word | expression database
 vector_string *puzzle;
+// where the session is kept between runs (NULL for nowhere) and the
+// identity of the input files it belongs to
+const char *snapshot;
+unsigned long long identity;
+// the files of the database
+loader files;
+// files left out that the screens were told about
+int reported;
 
 // declaration of the functions used by the game
 // for more details go to the definition of each
 
-// declare used colors (ncurses)
-void declare_colors();
+// load the database in the background
+void *load_database(void *argument);
+// end the game if a file could not be loaded
+void check_loader();
+// wait for a key, checking the loader while waiting
+int read_key(WINDOW *win);
+// keep the session in the snapshot
+void save();
+// lay the screens out for the size of the terminal
+void layout(WINDOW *win);
+// give the terminal back, free everything and end the game
+void leave(WINDOW *win);
+bool resized(WINDOW *win, int ch);
 
 // menu switching functions
 void menu(WINDOW *win);
 void run(WINDOW *win);
-void start();
 void instructions(WINDOW *win);
 
 // menu printing functions
-void print_new_game(WINDOW *win);
-void print_hangman(WINDOW *win, int stage);
+void print_menu(WINDOW *win, int key);
 void message_win(WINDOW *win);
 void message_lose(WINDOW *win);
+void message_empty(WINDOW *win);
 
-// util functions
-void alocator(vector_string *v);
-void expression_store(FILE *source, vector_string *expr);
-int  clean_for_print(char *s, int size);
-void create_hidden_string(char *string, char *hidden);
-int find_character(char *string, char *hidden, char *mistakes, int ch);
+// static screens, printed once at startup (see cache_screen)
+void draw_menu(WINDOW *win);
+void draw_instructions(WINDOW *win);
+void draw_win(WINDOW *win);
+void draw_lose(WINDOW *win);
+void draw_empty(WINDOW *win);
 
 
 // the main function of the game
-int main(int argc, char const *argv[])
+int main(int argc, char *const argv[])
 {
-	srand(time(NULL));
+	PROBE_INIT();
+	// the terminal shows the characters of the locale (utf-8), it is set
+	// before the loader starts
+	setlocale(LC_ALL, "");
 
 	// create game & puzzle data
-	game = (data *) malloc(sizeof(data));
-	puzzle = (vector_string *) malloc(sizeof(vector_string));
-
-	puzzle->dim = 20;
-	puzzle->chars = 0;
-	puzzle->count = 0;
-	puzzle->exprs = 0;
-	alocator(puzzle);
-
-	game->index = -1;
-	game->score = 0;
-	game->stage = 0;
-	game->string   = (char *) calloc(STRING_SIZE, sizeof(char));
-	game->hidden   = (char *) calloc(STRING_SIZE, sizeof(char));
-	game->mistakes = (char *) calloc(MISTAKES, sizeof(char));
-
- 	if (argc <= 1)
+	game = game_create();
+	puzzle = database_create();
+	game->seed = time(NULL);
+
+	int option;
+	while ((option = getopt(argc, argv, "s:")) != -1)
+	{
+		switch (option)
+		{
+		case 's':
+			snapshot = optarg;
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+
+ 	if (optind >= argc)
  	{
- 		fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman [<input-file-1> ...]\n\n");
+ 		fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman [-s <snapshot-file>] [<input-file-1> ...]\n\n");
  		return FAILURE;
  	}
 
-	// create the word | expression database
- 	for (int index = 1; index < argc; ++index)
+	// open the files of the word | expression database; they are
+	// checked before the terminal is taken, what is only found while
+	// they are loaded is reported by check_loader
+	files = (loader) {(int *) malloc(sizeof(int) * argc), argv + optind, 0, -1};
+ 	for (int index = optind; index < argc; ++index)
  	{
-		FILE *in = fopen(argv[index], "r");
-		if (in == NULL)
+		int in = open(argv[index], O_RDONLY);
+		if (in < 0)
 		{
 			fprintf(stderr, "[Error] File %s failed to open\n\n", argv[index]);
 			return FAILURE;
 		}
- 		expression_store(in, puzzle);
-        fclose(in);
+		if (database_check(in) != SUCCESS)
+		{
+			fprintf(stderr, "[Error] Could not parse the file %s\n\n", argv[index]);
+			return FAILURE;
+		}
+		files.files[files.count++] = in;
  	}
 
-	// prepare the terminal for the game
-	char *terminal = (char *) malloc (30 * sizeof(char));
-	sprintf(terminal, "printf '\e[8;%d;%dt'", ROWS, COLS);
- 	system(terminal);
-	free(terminal);
+	// the last session goes on: the match and the expressions already
+	// played (they are left out while the database loads)
+	resume = false;
+	identity = snapshot_files(files.files, files.count);
+	if (snapshot)
+		snapshot_restore(snapshot, game, puzzle, identity, &resume);
 
+	// create the database while the menu is already up
+	database_loading(puzzle, files.count);
+	if (pthread_create(&files.thread, NULL, load_database, &files))
+	{
+		fprintf(stderr, "[Error] Could not start a thread\n");
+		return FAILURE;
+	}
+
+	// prepare the terminal for the game, the window takes all of it
  	initscr();
-	WINDOW* window = newwin(ROWS, COLS, 0, 0);
+	WINDOW* window = newwin(LINES, COLS, 0, 0);
 
    	start_color();
    	declare_colors();
@@ -154,81 +173,159 @@ int main(int argc, char const *argv[])
 
 	keypad(window, TRUE);
 	curs_set(FALSE);
+	layout(window);
+
+	// the screens that never change are printed only once (and again
+	// when the terminal is resized)
+	cache_screen(SCREEN_MENU, draw_menu);
+	cache_screen(SCREEN_INSTRUCTIONS, draw_instructions);
+	cache_screen(SCREEN_GAME, print_new_game);
+	cache_screen(SCREEN_WIN, draw_win);
+	cache_screen(SCREEN_LOSE, draw_lose);
+	cache_screen(SCREEN_EMPTY, draw_empty);
 
 	// start game logic
 	// enter main menu
-	resume = false;
   	menu(window);
+	leave(window);
+}
 
-	// game exit
-  	werase(window);
-  	delwin(window);
-    endwin();
+// store the files in the database one after another
+void *load_database(void *argument)
+{
+	loader *files = (loader *) argument;
+	int failed = database_store_files(puzzle, files->files, files->count, 0);
+	for (int index = 0; index < files->count; ++index)
+		close(files->files[index]);
+	__atomic_store_n(&files->overflows, puzzle->overflows, __ATOMIC_RELEASE);
+	__atomic_store_n(&files->failed, failed, __ATOMIC_RELEASE);
+	database_loading(puzzle, -files->count);
+	return NULL;
+}
 
-	// free the data from the heap
-    free(game->mistakes);
-    free(game->hidden);
-    free(game->string);
-	for (int index = 0; index < puzzle->count; ++index)
-		free(puzzle->expressions[index]);
-    free(puzzle->expressions);
-    return SUCCESS;
+// a file that could not be parsed ends the game: the terminal is given
+// back first (only this thread uses ncurses), then the file is named
+void check_loader()
+{
+	int failed = __atomic_load_n(&files.failed, __ATOMIC_ACQUIRE);
+	if (failed < 0)
+		return;
+	endwin();
+	fprintf(stderr, "[Error] Could not parse the file %s\n\n", files.names[failed]);
+	exit(FAILURE);
 }
 
-// initializing NCURSES colors
-void declare_colors()
+// wait for a key (the screens that wait for one check the loader at
+// every tick); KEY_REFRESH is returned when the loader left out more
+// files, for the menu to show them
+int read_key(WINDOW *win)
 {
-  	init_pair(1, COLOR_YELLOW, COLOR_BLACK);
-   	init_pair(2, COLOR_GREEN, COLOR_BLACK);
-   	init_pair(3, COLOR_BLUE, COLOR_BLACK);
-   	init_pair(4, COLOR_RED, COLOR_BLACK);
-	init_pair(5, COLOR_BLACK, COLOR_RED);
+	int ch;
+	wtimeout(win, TICK);
+	while ((ch = wgetch(win)) == ERR)
+	{
+		check_loader();
+		int overflows = __atomic_load_n(&files.overflows, __ATOMIC_ACQUIRE);
+		if (overflows != reported)
+		{
+			reported = overflows;
+			ch = KEY_REFRESH;
+			break;
+		}
+	}
+	wtimeout(win, -1);
+	return ch;
 }
 
-// main menu logic
-void menu(WINDOW *win)
+// write the snapshot of the session, if there is one
+void save()
 {
-	char menu[3][12] = {"New Game", "Resume Game", "Quit"};
+	if (snapshot && snapshot_save(snapshot, game, puzzle, identity, resume) != SUCCESS)
+		snapshot = NULL;
+}
 
-	while (true)
+// fit the window and the cached screens to the terminal; a terminal
+// too small for the screens shows only a message until it is larger
+// (or Q ends the game)
+void layout(WINDOW *win)
+{
+	while (LINES < MIN_ROWS || COLS < MIN_COLS)
 	{
-		// clean-up console
-		werase (win);
-		wbkgd (win, COLOR_PAIR(1));
+		wresize(win, LINES, COLS);
+		werase(win);
+		char text[128];
+		snprintf(text, sizeof(text), "The terminal is %dx%d, the game needs at least %dx%d.", COLS, LINES, MIN_COLS, MIN_ROWS);
+		wattron(win, COLOR_PAIR(4));
+		int rows = print_wrapped(win, 0, 0, COLS, LINES - 1, false, text);
+		print_wrapped(win, rows, 0, COLS, LINES - rows, false, "Press Q to quit.");
+		wattroff(win, COLOR_PAIR(4));
+		wtimeout(win, -1);
+		int ch;
+		while ((ch = read_key(win)) != KEY_RESIZE)
+			if (toupper(ch) == 'Q')
+				leave(win);
+	}
+	wresize(win, LINES, COLS);
+	resize_screens();
+}
 
-		// print main title
-		wattron(win, COLOR_PAIR(1));
-		box(win, 0, 0);
-		mvwprintw(win,  3, 3, "Adrian Chiornita FIRST game (don't judge :D):");
-		mvwprintw(win,  6, (COLS - 62) / 2, "##   ##    ###    ##   ##   #####   ##   ##    ###    ##   ##");
-		mvwprintw(win,  7, (COLS - 62) / 2, "##   ##   ## ##   ###  ##  ##    #  ### ###   ## ##   ###  ##");
-		mvwprintw(win,  8, (COLS - 62) / 2, "#######  #######  ## # ##  ##       ## # ##  #######  ## # ##");
-		mvwprintw(win,  9, (COLS - 62) / 2, "##   ##  ##   ##  ##  ###  ##  ###  ##   ##  ##   ##  ##  ###");
-		mvwprintw(win, 10, (COLS - 62) / 2, "##   ##  ##   ##  ##   ##   #####   ##   ##  ##   ##  ##   ##");
-		mvwprintw(win, 18, (COLS - 62) / 2, "                   PRESS I FOR INSTRUCTIONS.                 ");
+// game exit: the session is kept, the terminal is given back and the
+// loader is stopped before the data is freed
+void leave(WINDOW *win)
+{
+	save();
+
+  	werase(win);
+  	delwin(win);
+	free_screens();
+    endwin();
+
+	// stop loading the database
+	database_cancel(puzzle);
+	pthread_join(files.thread, NULL);
+	free(files.files);
 
-		// print menu buttons
-		mvwprintw(win, QUIT, (COLS - strlen(menu[2])) / 2, "%s", menu[2]);
-		wattroff(win, COLOR_PAIR(1));
+	// free the data from the heap
+    game_destroy(game);
+    database_destroy(puzzle);
+	exit(SUCCESS);
+}
+
+// handle a key read by a screen: if the terminal was resized (ncurses
+// turns SIGWINCH in KEY_RESIZE) the screens are laid out again
+// returns true if the screen has to be shown again
+bool resized(WINDOW *win, int ch)
+{
+	if (ch != KEY_RESIZE)
+		return false;
+	layout(win);
+	return true;
+}
 
-		if (!resume)
-			wattron(win, COLOR_PAIR(5));
-		mvwprintw(win, RESUME, (COLS - strlen(menu[1])) / 2, "%s", menu[1]);
-		if (!resume)
-			wattroff(win, COLOR_PAIR(5));
 
-		wattron (win, COLOR_PAIR(3));
-		mvwprintw (win, NEW, (COLS - strlen(menu[0])) / 2, "%s", menu[0]);
-		wattroff (win, COLOR_PAIR(3));
+// main menu logic
+void menu(WINDOW *win)
+{
+	while (true)
+	{
+		save();
 
 		// menu button logic
 		int key = NEW;
+		print_menu(win, key);
 		while (true)
 		{
 			// refresh
 			wrefresh(win);
 			// get input
-			int ch = wgetch(win);
+			int ch = read_key(win);
+
+			// the terminal was resized, or there are files left out
+			if (resized(win, ch) || ch == KEY_REFRESH)
+			{
+				print_menu(win, key);
+				continue;
+			}
 
 			// enter instructions menu
 			if (toupper(ch) == 'I')
@@ -246,7 +343,7 @@ void menu(WINDOW *win)
 			{
 			case KEY_UP:
 				wattron(win,  COLOR_PAIR(1));
-				mvwprintw(win, key, (COLS - strlen(menu[key - NEW])) / 2, "%s", menu[key - NEW]);
+				mvwprintw(win, area.buttons_row + key, (COLS - strlen(buttons[key])) / 2, "%s", buttons[key]);
 				wattroff(win, COLOR_PAIR(1));
 
 				key--;
@@ -257,7 +354,7 @@ void menu(WINDOW *win)
 				break;
 			case KEY_DOWN:
 				wattron(win,  COLOR_PAIR(1));
-				mvwprintw(win, key, (COLS - strlen(menu[key - NEW])) / 2, "%s", menu[key - NEW]);
+				mvwprintw(win, area.buttons_row + key, (COLS - strlen(buttons[key])) / 2, "%s", buttons[key]);
 				wattroff(win, COLOR_PAIR(1));
 
 				key++;
@@ -277,8 +374,10 @@ void menu(WINDOW *win)
 				if (key == NEW)
 				{
 					game->score = 0;
-					start();
-					run(win);
+					if (start(game, puzzle) == SUCCESS)
+						run(win);
+					else
+						message_empty(win);
 				}
 				// resume last game
 				if (key == RESUME)
@@ -292,204 +391,163 @@ void menu(WINDOW *win)
 
 			// change collor of the current button
 			wattron(win,  COLOR_PAIR(3));
-			mvwprintw(win, key, (COLS - strlen(menu[key - NEW])) / 2, "%s", menu[key - NEW]);
+			mvwprintw(win, area.buttons_row + key, (COLS - strlen(buttons[key])) / 2, "%s", buttons[key]);
 			wattroff(win, COLOR_PAIR(3));
 		}
 	}
 }
 
-// start a new game logic
-void start()
+// print the main menu with the button key selected
+void print_menu(WINDOW *win, int key)
 {
-	// if a new game is started remove a word
-	if (game->index >= 0)
+	// the menu without the buttons that change
+	show_screen(win, SCREEN_MENU);
+
+	if (!resume)
+		wattron(win, COLOR_PAIR(5));
+	mvwprintw(win, area.buttons_row + RESUME, (COLS - strlen(buttons[RESUME])) / 2, "%s", buttons[RESUME]);
+	if (!resume)
+		wattroff(win, COLOR_PAIR(5));
+
+	wattron (win, COLOR_PAIR(3));
+	mvwprintw (win, area.buttons_row + key, (COLS - strlen(buttons[key])) / 2, "%s", buttons[key]);
+	wattroff (win, COLOR_PAIR(3));
+
+	// the files left out are not played, the player is told once the
+	// database is loaded
+	int overflows = reported;
+	if (overflows)
 	{
-		puzzle->chars -= puzzle->sizes[game->index];
-		puzzle->sizes[game->index] = 0;
-		puzzle->exprs--;
+		char text[96];
+		snprintf(text, sizeof(text), "%d %s left out, the alphabet is full.", overflows, overflows == 1 ? "file" : "files");
+		wattron(win, COLOR_PAIR(5));
+		print_wrapped(win, LINES - 3, 1, COLS - 2, 2, true, text);
+		wattroff(win, COLOR_PAIR(5));
 	}
-
-	// get a random word | expression from the database
-	int random_number = rand() % puzzle->count;
-	while (!puzzle->sizes[random_number])
-		random_number = rand() % puzzle->count;
-
-	strcpy(game->string, puzzle->expressions[random_number]);
-
-	// create the new hidden string
-	create_hidden_string(game->string, game->hidden);
-	game->mistakes = (char *) calloc(MISTAKES, sizeof(char));
-
-	game->stage = 0;
-	game->index = random_number;
 }
 
 // run a game match
 void run (WINDOW *win)
 {
-	// clean console and print the game table
-	werase(win);
-	wbkgd(win, COLOR_PAIR (1));
-	print_new_game(win);
+	// print the game table
+	show_screen(win, SCREEN_GAME);
 
-	time_t rawtime;
-  	struct tm * timeinfo;
+	// everything has to be shown once
+	frame drawn = {-1, -1, ""};
+	game->changed = CHANGED_ALL;
+	resume = true;
+	save();
 
-	int len = strlen(game->string);
-	bool victory = false;
 	while (true)
 	{
-		// refresh statistics
-		time(&rawtime);
- 		timeinfo = localtime (&rawtime);
-
-		wrefresh(win);
-
-		// print statistics
-		wattron(win,  COLOR_PAIR (1));
-		box(win, 0 , 0);
-		mvwprintw(win, 1, 1, "Score: %i", game->score);
-		mvwprintw(win, 1, COLS - strlen(asctime (timeinfo)) - 5, "%s", asctime (timeinfo));
-		mvwprintw(win, 1, 15, " Expressions: %i", puzzle->exprs);
-		mvwprintw(win, 1, 41, "Characters: %i", puzzle->chars);
-		mvwprintw(win, 8, COLS - strlen (game->hidden) - 5, "%s", game->hidden);
-		mvwprintw(win, 4, COLS - 23, "%s", game->mistakes);
-		wattron(win,  COLOR_PAIR (1));
-
-		//print hangman stage
-		print_hangman(win, game->stage);
+		check_loader();
+
+		// print only what changed and send it to the terminal at once
+		PROBE_BEGIN(render);
+		print_match(win, game, puzzle, &drawn);
+		wnoutrefresh(win);
+		doupdate();
+		PROBE_END(PHASE_RENDER, render);
 
 		// print message if lose
-		if (game->stage == 6)
+		if (game_status(game) == FAILURE)
 		{
 			message_lose(win);
 			break;
 		}
 		// print message if win
-		if(victory)
+		if (game_status(game) == SUCCESS)
 		{
 			message_win(win);
 			break;
 		}
 
-		// get a character
-		int ch = wgetch(win);
-
-		// if backspace return to main menu
-		if (ch == KEY_BACKSPACE)
+		// wait for a key at most until the clock needs to tick
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+		wtimeout(win, TICK - now.tv_nsec / 1000000 % TICK);
+		wint_t ch;
+		int read = wget_wch(win, &ch);
+
+		// apply every key already typed before printing again (the keys
+		// of ncurses come apart from the characters, that are code points)
+		bool back = false;
+		while (read != ERR)
 		{
-			resume = true;
-			werase(win);
-			break;
-		}
-
-		// if is another printable character
-		// then do hangman logic
-		if (isprint(ch))
-		{
-			// find if character is in the hidden word
-			int searcher = find_character(game->string, game->hidden, game->mistakes, ch);
-
-			// character found
-			if (searcher == 1)
+			// if backspace return to main menu
+			if (read == KEY_CODE_YES && ch == KEY_BACKSPACE)
 			{
-				game->score += ch * searcher;
-
-				victory = true;
-				for (int index = 0; index < len; ++index)
-					if (game->hidden[index] != toupper (game->string[index]))
-						victory = false;
+				back = true;
+				break;
 			}
-			// character not found
-			else if(searcher == -1)
+
+			// the table moves with the size of the terminal, so
+			// everything is printed again
+			if (read == KEY_CODE_YES && resized(win, ch))
 			{
-				game->stage++;
-				game->score -= ch * searcher;
-
-				int len = strlen(game->mistakes);
-				game->mistakes[len] = toupper(ch);
-				game->mistakes[len + 1] = ',';
-				game->mistakes[len + 2] = ' ';
-				game->mistakes[len + 3] = '\0';
+				show_screen(win, SCREEN_GAME);
+				drawn = (frame) {-1, -1, ""};
+				game->changed = CHANGED_ALL;
 			}
+			// if is another printable character
+			// then do hangman logic
+			else if (read != KEY_CODE_YES && iswprint(ch))
+				guess_character(game, ch);
+			if (game_status(game) != RUNNING)
+				break;
+
+			wtimeout(win, 0);
+			read = wget_wch(win, &ch);
+		}
+		wtimeout(win, -1);
+
+		if (back)
+		{
+			resume = true;
+			break;
 		}
 	}
 }
 
+
+
 // print instruction menu
 void instructions(WINDOW *win)
 {
-	werase(win);
-	wbkgd(win, COLOR_PAIR(1));
-
-	wattron(win, COLOR_PAIR(3));
-	box(win, 0, 0);
-	mvwprintw(win, 1, 1, "INSTRUCTIONS:");
-	mvwprintw(win, 3, 2, "   _________________________________");
-	mvwprintw(win, 4, 2, "        []  //                 |");
-	mvwprintw(win, 5, 2, "        [] //                  |");
-	mvwprintw(win, 6, 2, "        []//                   |");
-	mvwprintw(win, 7, 2, "        []/                    |");
-	mvwprintw(win, 8, 2, "        []");
-	mvwprintw(win, 9, 2, "        []");
-	mvwprintw(win, 10, 2, "        []");
-	mvwprintw(win, 11, 2, "        []");
-	mvwprintw(win, 12, 2, "        []");
-	mvwprintw(win, 13, 2, "        []");
-	mvwprintw(win, 14, 2, "        []");
-	mvwprintw(win, 15, 2, "        []");
-	mvwprintw(win, 16, 2, "        []");
-	mvwprintw(win, 17, 2, "        []\\");
-	mvwprintw(win, 18, 2, "       /[]\\\\");
-	mvwprintw(win, 19, 2, "______//[]_\\\\_________");
-	mvwprintw(win, 20, 1, "|______________________|");
-	mvwprintw(win, 22, 2, "PRESS BACKSPACE TO RETURN");
-	mvwprintw(win, 3, 40, "Hangman is a paper and pencil guessing game for two or more players.");
-	mvwprintw(win, 4, 40, "One player thinks of a word, phrase or sentence and the other");
-	mvwprintw(win, 5, 40, "tries to guess it by suggesting letters, within a certain number of guesses.");
-	mvwprintw(win, 6, 40, "You are a programmer, so you must play with your best friend, a computer.");
-	wattroff(win, COLOR_PAIR(3));
-
-	print_hangman(win, 6);
+	show_screen(win, SCREEN_INSTRUCTIONS);
 
 	int ch = 0;
 	while (ch != KEY_BACKSPACE)
-		ch = wgetch(win);
+	{
+		ch = read_key(win);
+		if (resized(win, ch))
+			show_screen(win, SCREEN_INSTRUCTIONS);
+	}
 }
 
 // print message lose menu
 void message_lose(WINDOW *win)
 {
-	werase(win);
-	wbkgd(win, COLOR_PAIR(1));
-
-	wattron(win, COLOR_PAIR(4));
-	box(win, 0, 0);
-	mvwprintw(win, 10, (COLS - 72) / 2, " #####     ###    ##   ##  #####     #####   ##   ##  ######  ######  ##");
-	mvwprintw(win, 11, (COLS - 72) / 2, "##    #   ## ##   ### ###  ##       ##   ##  ##   ##  ##      ##  ##  ##");
-	mvwprintw(win, 12, (COLS - 72) / 2, "##       #######  ## # ##  ####     ##   ##  ##   ##  ####    ######  ##");
-	mvwprintw(win, 13, (COLS - 72) / 2, "##  ###  ##   ##  ##   ##  ##       ##   ##   ## ##   ##      ## ##     ");
-	mvwprintw(win, 14, (COLS - 72) / 2, " #####   ##   ##  ##   ##  ######    #####     ###    ######  ##  ##  ##");
-
-	mvwprintw(win, 17, (COLS - 73) / 2, "PRESS Q TO RETURN TO MENU.                   PRESS N TO START A NEW GAME.");
-	wattroff(win, COLOR_PAIR(4));
+	show_screen(win, SCREEN_LOSE);
 
 	while (true)
 	{
 		// switch to a new menu
-		int ch = wgetch(win);
+		int ch = read_key(win);
+		if (resized(win, ch))
+			show_screen(win, SCREEN_LOSE);
 		if (toupper(ch) == 'Q')
 		{
 			resume = false;
-			werase(win);
 			break;
 		}
 		if (toupper(ch) == 'N')
 		{
-			werase(win);
 			game->score = 0;
-			start();
-			run(win);
+			if (start(game, puzzle) == SUCCESS)
+				run(win);
+			else
+				message_empty(win);
 			break;
 		}
 	}
@@ -498,278 +556,170 @@ void message_lose(WINDOW *win)
 // print message win menu
 void message_win(WINDOW *win)
 {
-	werase(win);
-	wbkgd(win, COLOR_PAIR(1));
-
-	wattron(win, COLOR_PAIR(2));
-	box(win, 0, 0);
-	mvwprintw(win, 10, (COLS - 60) / 2, "##   ##   #####   ##   ##      ##  ##  ##  ##  ##   ##  ##");
-	mvwprintw(win, 11, (COLS - 60) / 2, " ## ##   ##   ##  ##   ##      ##  ##  ##  ##  ###  ##  ##");
-	mvwprintw(win, 12, (COLS - 60) / 2, "  ###    ##   ##  ##   ##      ##  ##  ##  ##  ## # ##  ##");
-	mvwprintw(win, 13, (COLS - 60) / 2, "  ##     ##   ##  ##   ##       ## ## ##   ##  ##  ###    ");
-	mvwprintw(win, 14, (COLS - 60) / 2, "  ##      #####   #######        ######    ##  ##   ##  ##");
-	mvwprintw(win, 17, (COLS - 60) / 2, "PRESS Q TO RETURN TO MENU.   PRESS N TO CONTINUE THE GAME.");
-	wattroff(win, COLOR_PAIR(2));
+	show_screen(win, SCREEN_WIN);
 
 	while (true)
 	{
 		// switch to a new menu
-		int ch = wgetch(win);
+		int ch = read_key(win);
+		if (resized(win, ch))
+			show_screen(win, SCREEN_WIN);
 		if (toupper(ch) == 'Q')
 		{
 			resume = false;
-			werase(win);
 			break;
 		}
 		if (toupper(ch) == 'N')
 		{
-			werase(win);
-			start();
-			run(win);
+			if (start(game, puzzle) == SUCCESS)
+				run(win);
+			else
+				message_empty(win);
 			break;
 		}
 	}
 }
 
-// print a new hangman game
-void print_new_game(WINDOW *win)
+// print message when the database has no more expressions
+void message_empty(WINDOW *win)
 {
-	wattron(win, COLOR_PAIR(1));
-	for (int index = 1; index < COLS; ++index)
-			mvwprintw(win, 2, index, "_");
-	mvwprintw(win,  3, 2, "   _________________________________");
-	mvwprintw(win,  4, 2, "        []  //                 |");
-	mvwprintw(win,  5, 2, "        [] //                  |");
-	mvwprintw(win,  6, 2, "        []//                   |");
-	mvwprintw(win,  7, 2, "        []/                    |");
-	mvwprintw(win,  8, 2, "        []");
-	mvwprintw(win,  9, 2, "        []");
-	mvwprintw(win, 10, 2, "        []");
-	mvwprintw(win, 11, 2, "        []");
-	mvwprintw(win, 12, 2, "        []");
-	mvwprintw(win, 13, 2, "        []");
-	mvwprintw(win, 14, 2, "        []");
-	mvwprintw(win, 15, 2, "        []");
-	mvwprintw(win, 16, 2, "        []");
-	mvwprintw(win, 17, 2, "        []\\");
-	mvwprintw(win, 18, 2, "       /[]\\\\");
-	mvwprintw(win, 19, 2, "______//[]_\\\\_________");
-	mvwprintw(win, 20, 1, "|______________________|");
-	mvwprintw(win, 22, 1, "______________________________________________");
-	mvwprintw(win, 23, 1, "                                              |");
-	mvwprintw(win, 24, 2, "Press BACKSPACE to return to the Main Menu.  |");
-	mvwprintw(win, 25, 2, "Press a character to see if you guessed      |");
-	mvwprintw(win, 26, 2, "a letter in the expression.                  |");
-	mvwprintw(win, 27, 1, "                                              |");
-	mvwprintw(win, 28, 1, "______________________________________________|");
-	wattroff(win, COLOR_PAIR(1));
+	resume = false;
 
-	wattron (win, COLOR_PAIR(4));
-	mvwprintw (win, 3, COLS - 25, "| Mistakes Table:|");
-	mvwprintw (win, 4,	COLS - 25, "|                |");
-	mvwprintw (win, 5, COLS - 25, "|________________|");
-	wattroff (win, COLOR_PAIR(4));
-}
+	show_screen(win, SCREEN_EMPTY);
 
-// print hangman stage
-void print_hangman (WINDOW *win, int stage)
-{
-	wattron(win, COLOR_PAIR(4));
-	switch(stage)
-	{
-	case 6:
-		mvwprintw(win, 14, 34, "\\\\");
-		mvwprintw(win, 15, 34, " \\\\");
-		mvwprintw(win, 16, 34, "  \\\\");
-	case 5:
-		mvwprintw(win, 14, 29, "  // ");
-		mvwprintw(win, 15, 29, " //");
-		mvwprintw(win, 16, 29, "//");
-	case 4:
-		mvwprintw(win, 11, 35, "\\\\  ");
-		mvwprintw(win, 12, 35, " \\\\ ");
-		mvwprintw(win, 13, 35, "  \\\\");
-	case 3:
-		mvwprintw(win, 11, 28, "  //");
-		mvwprintw(win, 12, 28, " //");
-		mvwprintw(win, 13, 28, "//");
-	case 2:
-		mvwprintw(win, 11, 32, "[ ]");
-		mvwprintw(win, 12, 32, "[ ]");
-		mvwprintw(win, 13, 32, "[_]");
-	case 1:
-		mvwprintw(win,  7, 29, " ___|___");
-		mvwprintw(win,  8, 29, "// X 0 \\\\");
-		mvwprintw(win,  9, 29, " ]  ^  [");
-		mvwprintw(win, 10, 29, " \\__~__/");;
-		break;
-	}
-	wattroff(win, COLOR_PAIR (4));
+	int ch;
+	while (toupper(ch = read_key(win)) != 'Q')
+		if (resized(win, ch))
+			show_screen(win, SCREEN_EMPTY);
 }
 
-// this is called when we initialize a vector_string type
-// or when we want to allocate more memory into it
-void alocator(vector_string *vector)
+// print the main menu, the resume and new game buttons are printed
+// over it (they change)
+void draw_menu(WINDOW *win)
 {
-	// if it is first initialization
-	if (!vector->expressions || !vector->sizes)
+	// print main title
+	wattron(win, COLOR_PAIR(1));
+	box(win, 0, 0);
+	if (area.banner)
 	{
-		vector->expressions = (char**) malloc(sizeof(char *) * vector->dim);
-		vector->sizes = (int *) malloc(sizeof(int) * vector->dim);
+		mvwprintw(win,  3, 3, "Adrian Chiornita FIRST game (don't judge :D):");
+		mvwprintw(win,  6, (COLS - 62) / 2, "##   ##    ###    ##   ##   #####   ##   ##    ###    ##   ##");
+		mvwprintw(win,  7, (COLS - 62) / 2, "##   ##   ## ##   ###  ##  ##    #  ### ###   ## ##   ###  ##");
+		mvwprintw(win,  8, (COLS - 62) / 2, "#######  #######  ## # ##  ##       ## # ##  #######  ## # ##");
+		mvwprintw(win,  9, (COLS - 62) / 2, "##   ##  ##   ##  ##  ###  ##  ###  ##   ##  ##   ##  ##  ###");
+		mvwprintw(win, 10, (COLS - 62) / 2, "##   ##  ##   ##  ##   ##   #####   ##   ##  ##   ##  ##   ##");
 	}
-	// if the vector_string needs more memory
 	else
 	{
-		char **eaux = (char **) realloc(vector->expressions, sizeof(char *) * 2 * (vector->dim));
-		int *saux = (int *) realloc(vector->sizes, sizeof(int) * 2 * (vector->dim));
-		if (eaux && saux)
-		{
-			vector->expressions = eaux;
-			vector->sizes = saux;
-			vector->dim *= 2;
-		}
-		// Heap Memory is full
-		else
-		{
-			fprintf(stderr, "[Error] Not enough memory.\n");
-			exit(FAILURE);
-		}
+		if (COLS >= 49)
+			mvwprintw(win, 1, 3, "Adrian Chiornita FIRST game (don't judge :D):");
+		mvwprintw(win, area.title_row, (COLS - 7) / 2, "HANGMAN");
 	}
+	if (area.banner)
+		mvwprintw(win, area.menu_hint_row, (COLS - 62) / 2, "                   PRESS I FOR INSTRUCTIONS.                 ");
+	else
+		mvwprintw(win, area.menu_hint_row, (COLS - 25) / 2, "PRESS I FOR INSTRUCTIONS.");
+
+	// print the buttons that are not selected
+	mvwprintw(win, area.buttons_row + NEW, (COLS - strlen(buttons[NEW])) / 2, "%s", buttons[NEW]);
+	mvwprintw(win, area.buttons_row + QUIT, (COLS - strlen(buttons[QUIT])) / 2, "%s", buttons[QUIT]);
+	wattroff(win, COLOR_PAIR(1));
 }
 
-// store a line from the input file (word | expression) in
-// vec -- the puzzle database
-void expression_store(FILE *source, vector_string *vec)
+// print the instructions (on the right of the gallows, or on the whole
+// screen without it)
+void draw_instructions(WINDOW *win)
 {
-	// allocate a auxiliary buffer for reading
-	char *buffer = (char *) calloc(STRING_SIZE, sizeof (char));
-	int read = 0;
+	const char *text = "Hangman is a paper and pencil guessing game for two or more players. "
+		"One player thinks of a word, phrase or sentence and the other "
+		"tries to guess it by suggesting letters, within a certain number of guesses. "
+		"You are a programmer, so you must play with your best friend, a computer.";
 
-	//read each line
-	while(fgets(buffer, STRING_SIZE - 1, source))
+	wattron(win, COLOR_PAIR(3));
+	box(win, 0, 0);
+	mvwprintw(win, 1, 1, "INSTRUCTIONS:");
+	if (area.gallows)
 	{
-		read = strlen(buffer);
-		if (!read) continue;
-
-		// if the database is full call the allocator
-		if (vec->count == vec->dim) alocator(vec);
-
-		// clean the buffer for printing
-		read = clean_for_print(buffer, read);
-
-		// append the result into the puzzle database
-		vec->count++;
-		vec->sizes[vec->count - 1] = read;
-		vec->chars += read;
-		vec->expressions[vec->count - 1] = (char *) malloc(sizeof(char) * read);
-		strcpy(vec->expressions[vec->count - 1], buffer);
-
-		// error if the file couldn't be parsed
-		if (ferror(source))
-		{
-			fprintf(stderr, "[Error] Could not parse the file\n");
-			exit(FAILURE);
-		}
+		mvwprintw(win, 3, 2, "   _________________________________");
+		mvwprintw(win, 4, 2, "        []  //                 |");
+		mvwprintw(win, 5, 2, "        [] //                  |");
+		mvwprintw(win, 6, 2, "        []//                   |");
+		mvwprintw(win, 7, 2, "        []/                    |");
+		for (int row = 8; row < 17; ++row)
+			mvwprintw(win, row, 2, "        []");
+		mvwprintw(win, 17, 2, "        []\\");
+		mvwprintw(win, 18, 2, "       /[]\\\\");
+		mvwprintw(win, 19, 2, "______//[]_\\\\_________");
+		mvwprintw(win, 20, 1, "|______________________|");
+		mvwprintw(win, 22, 2, "PRESS BACKSPACE TO RETURN");
+		print_wrapped(win, 3, 40, COLS - 41, 18, false, text);
 	}
-	// clean-up
-	vec->exprs = vec->count;
-	free(buffer);
-}
-
-// cleaning the passed string in order to be printed on console
-int clean_for_print(char *string, int size)
-{
-	for (int index = 0; index < size; ++index)
+	else
 	{
-		// if we have multiple spaces in the string or charaters that are
-		// not printable, we remove them in order for the game to be simple
-		if (!isprint(string[index]) ||
-			(index > 1 && isspace(string[index - 1]) && isspace(string[index])))
-		{
-			memmove(string + index, string + index + 1, size - index);
-			--index;
-			--size;
-		}
-		// transform all alphabetical characters into lowercase ones
-		if (isalpha(string[index]))
-			string[index]= tolower(string[index]);
+		print_wrapped(win, 2, 1, COLS - 2, LINES - 4, false, text);
+		mvwprintw(win, LINES - 2, 1, "PRESS BACKSPACE TO RETURN");
 	}
-	return size;
+	wattroff(win, COLOR_PAIR(3));
+
+	if (area.gallows)
+		print_hangman(win, 6);
 }
 
-// create a hidden string (string with _ where a letter should be guessed)
-// from the word | expression given
-void create_hidden_string(char *string, char *hidden)
+// print the lose message
+void draw_lose(WINDOW *win)
 {
-	// init hidden
-	strcpy (hidden, "");
-
-	// make a copy of the unhidden string
-	char *aux = (char*) malloc(sizeof(char) * STRING_SIZE);
-	strcpy(aux, string);
-
-	char sep[] = " ";
-	char *pt = strtok(aux, sep);
-
-	// iterate over each word in the hidden expression
-	// transform words like banana -> b _ _ _ _ a
-	while (pt)
+	int row = area.message_row;
+	wattron(win, COLOR_PAIR(4));
+	box(win, 0, 0);
+	if (area.big)
 	{
-		int len = strlen (pt);
-		if (len == 1) pt[0] = '_';
-		else
-			if (len == 2)
-			{
-				pt[0] = toupper(pt[0]);
-				pt[1] = '_';
-			}else
-			{
-				pt[0] = toupper(pt[0]);
-				pt[len - 1] = toupper(pt[len -1]);
-
-				for (int index = 1; index < len -1; ++index)
-					pt[index] = '_';
-			}
-
-		strcat(hidden, pt);
-		strcat(hidden, " ");
-
-		pt = strtok(NULL, sep);
+		mvwprintw(win, row, (COLS - 72) / 2, " #####     ###    ##   ##  #####     #####   ##   ##  ######  ######  ##");
+		mvwprintw(win, row + 1, (COLS - 72) / 2, "##    #   ## ##   ### ###  ##       ##   ##  ##   ##  ##      ##  ##  ##");
+		mvwprintw(win, row + 2, (COLS - 72) / 2, "##       #######  ## # ##  ####     ##   ##  ##   ##  ####    ######  ##");
+		mvwprintw(win, row + 3, (COLS - 72) / 2, "##  ###  ##   ##  ##   ##  ##       ##   ##   ## ##   ##      ## ##     ");
+		mvwprintw(win, row + 4, (COLS - 72) / 2, " #####   ##   ##  ##   ##  ######    #####     ###    ######  ##  ##  ##");
+		mvwprintw(win, row + 7, (COLS - 73) / 2, "PRESS Q TO RETURN TO MENU.                   PRESS N TO START A NEW GAME.");
 	}
-
-	// iterate over each word in the hidden expression
-	// transform words like b _ _ _ _ a -> b a _ a _ a
-	int len = strlen (hidden);
-	for (int index = 0; index < len; ++index)
-		if (hidden[index] != '_' && hidden[index] != ' ')
-		{
-			for (int j = 0; j < len; ++j)
-				if (tolower(hidden[index]) == string[j])
-					hidden[j] = hidden[index];
-
-		}
-	hidden[len] = '\0';
+	else
+	{
+		mvwprintw(win, row, (COLS - 10) / 2, "GAME OVER!");
+		mvwprintw(win, row + 2, (COLS - 26) / 2, "PRESS Q TO RETURN TO MENU.");
+		mvwprintw(win, row + 3, (COLS - 28) / 2, "PRESS N TO START A NEW GAME.");
+	}
+	wattroff(win, COLOR_PAIR(4));
 }
 
-// find if a character is in the hidden string and is not discovered yet
-int find_character(char *string, char *hidden, char *mistakes, int ch)
+// print the win message
+void draw_win(WINDOW *win)
 {
-	ch = tolower(ch);
-	if (strchr(string, ch))
+	int row = area.message_row;
+	wattron(win, COLOR_PAIR(2));
+	box(win, 0, 0);
+	if (area.big)
 	{
-		if (!strchr(hidden, toupper(ch)))
-		{
-			int len = strlen(string);
-			for (int index = 0; index < len; ++index)
-				if (string[index] == ch)
-					hidden[index] = toupper(ch);
-			return 1;
-		}
-		else
-			return 0;
+		mvwprintw(win, row, (COLS - 60) / 2, "##   ##   #####   ##   ##      ##  ##  ##  ##  ##   ##  ##");
+		mvwprintw(win, row + 1, (COLS - 60) / 2, " ## ##   ##   ##  ##   ##      ##  ##  ##  ##  ###  ##  ##");
+		mvwprintw(win, row + 2, (COLS - 60) / 2, "  ###    ##   ##  ##   ##      ##  ##  ##  ##  ## # ##  ##");
+		mvwprintw(win, row + 3, (COLS - 60) / 2, "  ##     ##   ##  ##   ##       ## ## ##   ##  ##  ###    ");
+		mvwprintw(win, row + 4, (COLS - 60) / 2, "  ##      #####   #######        ######    ##  ##   ##  ##");
+		mvwprintw(win, row + 7, (COLS - 60) / 2, "PRESS Q TO RETURN TO MENU.   PRESS N TO CONTINUE THE GAME.");
 	}
 	else
 	{
-		return (!strchr(mistakes, toupper(ch))) ? -1 : 0;
+		mvwprintw(win, row, (COLS - 8) / 2, "YOU WON!");
+		mvwprintw(win, row + 2, (COLS - 26) / 2, "PRESS Q TO RETURN TO MENU.");
+		mvwprintw(win, row + 3, (COLS - 29) / 2, "PRESS N TO CONTINUE THE GAME.");
 	}
-}
\ No newline at end of file
+	wattroff(win, COLOR_PAIR(2));
+}
+
+// print the message of an empty database
+void draw_empty(WINDOW *win)
+{
+	int row = area.big ? area.message_row + 2 : area.message_row;
+	wattron(win, COLOR_PAIR(3));
+	box(win, 0, 0);
+	row += print_wrapped(win, row, 1, COLS - 2, 2, true, "ALL THE EXPRESSIONS HAVE ALREADY BEEN PLAYED");
+	mvwprintw(win, area.big ? area.message_row + 7 : row + 1, (COLS - 26) / 2, "PRESS Q TO RETURN TO MENU.");
+	wattroff(win, COLOR_PAIR(3));
+}
@@ -0,0 +1,125 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "engine.h"
+#include "probe.h"
+
+// hangman-pack: precompiles word | expression files into a packed
+// database that the game maps and uses without parsing anything
+
+// declaration of the functions used by the tool
+void pack_write(vector_string *puzzle, FILE *out);
+
+// the main function of the tool
+int main(int argc, char *const argv[])
+{
+	PROBE_INIT();
+
+	const char *output = NULL;
+
+	int option;
+	while ((option = getopt(argc, argv, "o:")) != -1)
+	{
+		switch (option)
+		{
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+
+	if (!output || optind >= argc)
+	{
+		fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman-pack -o <output-file> [<input-file-1> ...]\n\n");
+		return FAILURE;
+	}
+
+	vector_string *puzzle = database_create();
+
+	// create the word | expression database, the files are parsed
+	// at the same time
+	int files[argc];
+	for (int index = optind; index < argc; ++index)
+	{
+		files[index - optind] = open(argv[index], O_RDONLY);
+		if (files[index - optind] < 0)
+		{
+			fprintf(stderr, "[Error] File %s failed to open\n\n", argv[index]);
+			return FAILURE;
+		}
+	}
+	int failed = database_store_files(puzzle, files, argc - optind, 0);
+	for (int index = 0; index < argc - optind; ++index)
+		close(files[index]);
+	if (failed >= 0)
+	{
+		fprintf(stderr, "[Error] Could not parse the file %s\n\n", argv[optind + failed]);
+		return FAILURE;
+	}
+
+	FILE *out = fopen(output, "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "[Error] File %s failed to open\n\n", output);
+		return FAILURE;
+	}
+	pack_write(puzzle, out);
+	if (fclose(out))
+	{
+		fprintf(stderr, "[Error] Could not write the file %s\n\n", output);
+		return FAILURE;
+	}
+
+	printf("%s: %d expressions, %zu characters (%d duplicates, %zu characters left out)\n",
+		output, puzzle->count, puzzle->used, puzzle->duplicates, puzzle->duplicated);
+	if (puzzle->overflows)
+		printf("%s: %d files left out, their characters did not fit in the alphabet (%d characters besides ascii)\n",
+			output, puzzle->overflows, GLYPHS);
+	database_destroy(puzzle);
+	return SUCCESS;
+}
+
+// write the header, the alphabet, the entries and the arena of the database
+void pack_write(vector_string *puzzle, FILE *out)
+{
+	pack_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+	header.version = PACK_VERSION;
+	header.count = puzzle->count;
+	header.bytes = puzzle->used;
+
+	// the padding of the entries is cleared, so the same database
+	// always gives the same file
+	entry *entries = (entry *) calloc(puzzle->count ? puzzle->count : 1, sizeof(entry));
+	if (!entries)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	for (int index = 0; index < puzzle->count; ++index)
+	{
+		entries[index].offset = puzzle->entries[index].offset;
+		entries[index].size = puzzle->entries[index].size;
+		entries[index].hash = puzzle->entries[index].hash;
+		entries[index].words = puzzle->entries[index].words;
+		entries[index].bucket = puzzle->entries[index].bucket;
+		entries[index].letters = puzzle->entries[index].letters;
+	}
+
+	header.checksum = checksum(&puzzle->glyphs, sizeof(alphabet), 0);
+	header.checksum = checksum(entries, sizeof(entry) * puzzle->count, header.checksum);
+	header.checksum = checksum(puzzle->arena, puzzle->used, header.checksum);
+
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(&puzzle->glyphs, sizeof(alphabet), 1, out);
+	fwrite(entries, sizeof(entry), puzzle->count, out);
+	fwrite(puzzle->arena, 1, puzzle->used, out);
+	free(entries);
+}
@@ -0,0 +1,180 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "probe.h"
+
+// latencies are kept in buckets: 8 for each power of two, so a
+// percentile is known with an error of at most 12.5%
+#define BUCKETS 496
+
+// measurements of a thread; every thread writes only its own table,
+// the tables are merged when the summary is printed
+typedef struct probe_table
+{
+	unsigned long long buckets[PHASES][BUCKETS];
+	unsigned long long total[PHASES];
+	unsigned long long max[PHASES];
+	unsigned long long counters[COUNTERS];
+	struct probe_table *next;
+} probe_table;
+
+static const char *phases[PHASES] = {"load", "clean", "start", "guess", "render"};
+static const char *counters[COUNTERS] = {"allocations", "allocated bytes", "expressions", "duplicates", "alphabet full"};
+
+static bool enabled;
+static const char *destination;
+static probe_table *tables;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local probe_table *local;
+
+// enable the probes if HANGMAN_STATS is set, the summary is printed at exit
+void probe_init()
+{
+	destination = getenv("HANGMAN_STATS");
+	if (!destination)
+		return;
+	enabled = true;
+	atexit(probe_dump);
+}
+
+// nanoseconds of the monotonic clock, 0 if the probes are disabled
+unsigned long long probe_now()
+{
+	if (!enabled)
+		return 0;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// table of the calling thread, created the first time it is used
+static probe_table *probe_local()
+{
+	if (!local)
+	{
+		local = (probe_table *) calloc(1, sizeof(probe_table));
+		if (!local)
+		{
+			enabled = false;
+			return NULL;
+		}
+		pthread_mutex_lock(&lock);
+		local->next = tables;
+		tables = local;
+		pthread_mutex_unlock(&lock);
+	}
+	return local;
+}
+
+// bucket of a latency
+static int probe_bucket(unsigned long long value)
+{
+	if (value < 8)
+		return value;
+	int octave = 63 - __builtin_clzll(value);
+	return (octave - 2) * 8 + ((value >> (octave - 3)) & 7);
+}
+
+// largest latency of a bucket
+static unsigned long long probe_limit(int bucket)
+{
+	if (bucket < 8)
+		return bucket;
+	int octave = bucket / 8 + 2;
+	return ((8ULL + bucket % 8 + 1) << (octave - 3)) - 1;
+}
+
+// record the latency of a phase that started at begin
+void probe_record(phase which, unsigned long long begin)
+{
+	probe_table *table;
+	if (!enabled || !(table = probe_local()))
+		return;
+
+	unsigned long long latency = probe_now() - begin;
+	table->buckets[which][probe_bucket(latency)]++;
+	table->total[which] += latency;
+	if (latency > table->max[which])
+		table->max[which] = latency;
+}
+
+// add value to a counter
+void probe_count(counter which, unsigned long long value)
+{
+	probe_table *table;
+	if (!enabled || !(table = probe_local()))
+		return;
+	table->counters[which] += value;
+}
+
+// latency under which are percent of the samples of a phase
+static unsigned long long probe_percentile(probe_table *table, phase which, unsigned long long samples, double percent)
+{
+	unsigned long long rank = samples * percent / 100, seen = 0;
+	for (int bucket = 0; bucket < BUCKETS; ++bucket)
+	{
+		seen += table->buckets[which][bucket];
+		if (seen > rank)
+			return probe_limit(bucket) < table->max[which] ? probe_limit(bucket) : table->max[which];
+	}
+	return table->max[which];
+}
+
+// merge the tables of all the threads and print the summary
+void probe_dump()
+{
+	probe_table *all = (probe_table *) calloc(1, sizeof(probe_table));
+	if (!all)
+		return;
+
+	pthread_mutex_lock(&lock);
+	for (probe_table *table = tables; table; table = table->next)
+	{
+		for (int which = 0; which < PHASES; ++which)
+		{
+			for (int bucket = 0; bucket < BUCKETS; ++bucket)
+				all->buckets[which][bucket] += table->buckets[which][bucket];
+			all->total[which] += table->total[which];
+			if (table->max[which] > all->max[which])
+				all->max[which] = table->max[which];
+		}
+		for (int which = 0; which < COUNTERS; ++which)
+			all->counters[which] += table->counters[which];
+	}
+	pthread_mutex_unlock(&lock);
+
+	FILE *out = strcmp(destination, "-") && *destination ? fopen(destination, "a") : stderr;
+	if (!out)
+	{
+		fprintf(stderr, "[Error] File %s failed to open\n\n", destination);
+		free(all);
+		return;
+	}
+
+	fprintf(out, "%-8s %12s %12s %10s %10s %10s\n", "phase", "count", "total ms", "p50 us", "p99 us", "max us");
+	for (int which = 0; which < PHASES; ++which)
+	{
+		unsigned long long samples = 0;
+		for (int bucket = 0; bucket < BUCKETS; ++bucket)
+			samples += all->buckets[which][bucket];
+		if (!samples)
+			continue;
+
+		fprintf(out, "%-8s %12llu %12.3f %10.3f %10.3f %10.3f\n", phases[which], samples,
+			all->total[which] / 1e6,
+			probe_percentile(all, which, samples, 50) / 1e3,
+			probe_percentile(all, which, samples, 99) / 1e3,
+			all->max[which] / 1e3);
+	}
+	for (int which = 0; which < COUNTERS; ++which)
+		fprintf(out, "%-16s %12llu\n", counters[which], all->counters[which]);
+
+	if (out != stderr)
+		fclose(out);
+	free(all);
+}
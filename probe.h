@@ -0,0 +1,52 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+// instrumentation of the engine and the game: latency histograms of the
+// main phases and a few counters, printed when the program exits
+//
+// it is compiled in with PROBES defined (make PROBES=1) and enabled at
+// runtime by the HANGMAN_STATS variable, that names the file where the
+// summary is written ("-" for stderr); without PROBES the macros below
+// are empty, so the measured code pays nothing
+
+// phases that are timed
+typedef enum phase
+{
+	PHASE_LOAD,
+	PHASE_CLEAN,
+	PHASE_START,
+	PHASE_GUESS,
+	PHASE_RENDER,
+	PHASES
+} phase;
+
+// events that are counted
+typedef enum counter
+{
+	COUNTER_ALLOCATIONS,
+	COUNTER_ALLOCATED,
+	COUNTER_EXPRESSIONS,
+	COUNTER_DUPLICATES,
+	COUNTER_OVERFLOWS,
+	COUNTERS
+} counter;
+
+#ifdef PROBES
+#define PROBE_INIT() probe_init()
+#define PROBE_BEGIN(name) unsigned long long probe_##name = probe_now()
+#define PROBE_END(phase, name) probe_record(phase, probe_##name)
+#define PROBE_COUNT(counter, value) probe_count(counter, value)
+#else
+#define PROBE_INIT()
+#define PROBE_BEGIN(name)
+#define PROBE_END(phase, name)
+#define PROBE_COUNT(counter, value)
+#endif
+
+void probe_init();
+unsigned long long probe_now();
+void probe_record(phase which, unsigned long long begin);
+void probe_count(counter which, unsigned long long value);
+void probe_dump();
+
+#endif
@@ -0,0 +1,373 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ncurses.h>
+#include <time.h>
+
+#include "engine.h"
+#include "screen.h"
+
+// the parts of the screens that are printed by more screens, and by
+// the benchmarks on a virtual screen
+
+// pads of the cached screens (NULL until they are printed) and the
+// functions that print them, to print them again at another size
+static WINDOW *screens[SCREENS];
+static void (*drawers[SCREENS])(WINDOW *win);
+
+// where the parts of the screens are now
+areas area;
+
+// initializing NCURSES colors
+void declare_colors()
+{
+  	init_pair(1, COLOR_YELLOW, COLOR_BLACK);
+   	init_pair(2, COLOR_GREEN, COLOR_BLACK);
+   	init_pair(3, COLOR_BLUE, COLOR_BLACK);
+   	init_pair(4, COLOR_RED, COLOR_BLACK);
+	init_pair(5, COLOR_BLACK, COLOR_RED);
+}
+
+// place the parts of the screens for the size of the terminal: at
+// FULL_COLS x FULL_ROWS and up every part is where it always was, in a
+// smaller terminal the parts that do not fit take a smaller form
+void place_screens()
+{
+	// the status line: the score, then the counters up to column 62 and
+	// the clock 29 columns from the right
+	area.counters = COLS >= 64;
+	area.clock = COLS - 30 >= (area.counters ? 63 : 17);
+
+	// the gallows takes 38 columns and 18 rows on the left, the hidden
+	// string is on its right (or under the mistakes table without it)
+	area.gallows = LINES >= 24 && COLS >= 64;
+	area.gallows_row = 3;
+	area.mistakes_row = 3;
+	area.mistakes_col = COLS - (area.gallows ? 25 : 20);
+	area.help = area.gallows && LINES >= 30;
+	area.help_row = 22;
+	area.hint_row = LINES - 2;
+	if (area.gallows)
+	{
+		area.hidden_row = 8;
+		area.hidden_rows = HIDDEN_ROWS;
+		area.hidden_right = COLS - 5;
+		area.hidden_width = COLS - 45 < HIDDEN_WIDTH ? COLS - 45 : HIDDEN_WIDTH;
+	}
+	else
+	{
+		area.hidden_row = 7;
+		area.hidden_rows = LINES - 10 < HIDDEN_ROWS ? LINES - 10 : HIDDEN_ROWS;
+		area.hidden_right = COLS - 3;
+		area.hidden_width = COLS - 5 < HIDDEN_WIDTH ? COLS - 5 : HIDDEN_WIDTH;
+	}
+
+	// the menu: the title in big letters over the buttons, or a line of
+	// it with the buttons in the middle
+	area.banner = LINES >= 20 && COLS >= 64;
+	area.title_row = area.banner ? 6 : (LINES - 3) / 2 - 2;
+	area.buttons_row = area.banner ? 13 : (LINES - 3) / 2;
+	area.menu_hint_row = area.banner ? 18 : area.buttons_row + 4;
+
+	// the win and lose messages are 74 columns and 8 rows in big letters
+	area.big = LINES >= 20 && COLS >= 76;
+	area.message_row = area.big ? LINES / 2 - 7 : LINES / 2 - 2;
+}
+
+// print a screen once in its pad, on the background of the game
+void cache_screen(screen_id which, void (*draw)(WINDOW *win))
+{
+	if (screens[which])
+		delwin(screens[which]);
+	drawers[which] = draw;
+	screens[which] = newpad(LINES, COLS);
+	if (!screens[which])
+	{
+		endwin();
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	wbkgd(screens[which], COLOR_PAIR(1));
+	draw(screens[which]);
+}
+
+// show a cached screen: one copy of its pad over the whole window
+void show_screen(WINDOW *win, screen_id which)
+{
+	wbkgdset(win, getbkgd(screens[which]));
+	copywin(screens[which], win, 0, 0, 0, 0, LINES - 1, COLS - 1, FALSE);
+}
+
+// place and print the cached screens again for the new size of the
+// terminal
+void resize_screens()
+{
+	place_screens();
+	for (int which = 0; which < SCREENS; ++which)
+		if (screens[which])
+			cache_screen(which, drawers[which]);
+}
+
+// free the pads of the cached screens
+void free_screens()
+{
+	for (int which = 0; which < SCREENS; ++which)
+		if (screens[which])
+			delwin(screens[which]);
+	memset(screens, 0, sizeof(screens));
+}
+
+// print the parts of a match that are not on the screen yet
+void print_match(WINDOW *win, data *game, vector_string *puzzle, frame *drawn)
+{
+	time_t rawtime;
+	time(&rawtime);
+
+	// refresh statistics
+	wattron(win,  COLOR_PAIR (1));
+	if (game->changed & CHANGED_SCORE)
+		mvwprintw(win, 1, 1, "Score: %i", game->score);
+	// the counters grow while the database is loading
+	int exprs, chars;
+	database_counters(puzzle, &exprs, &chars);
+	if (area.counters && drawn->exprs != exprs)
+	{
+		mvwprintw(win, 1, 15, " Expressions: %-9i", exprs);
+		drawn->exprs = exprs;
+	}
+	if (area.counters && drawn->chars != chars)
+	{
+		mvwprintw(win, 1, 41, "Characters: %-9i", chars);
+		drawn->chars = chars;
+	}
+	// asctime ends with a new line, that is not printed
+	char *clock = asctime(localtime(&rawtime));
+	if (area.clock && strcmp(drawn->clock, clock))
+	{
+		mvwprintw(win, 1, COLS - strlen(clock) - 5, "%.*s", (int) strlen(clock) - 1, clock);
+		strcpy(drawn->clock, clock);
+	}
+	if (game->changed & CHANGED_HIDDEN)
+		print_hidden(win, game);
+	if (game->changed & CHANGED_MISTAKES)
+		print_mistakes(win, game);
+	wattroff(win,  COLOR_PAIR (1));
+
+	//print hangman stage
+	if (game->changed & CHANGED_STAGE)
+		print_hangman(win, game->stage);
+
+	game->changed = 0;
+}
+
+// print the hidden string aligned to the right, split on more lines
+// (between words when possible) if it is longer than the area; the last
+// line ends with ... after its last whole word if the rest does not fit
+void print_hidden(WINDOW *win, const data *game)
+{
+	const char *string = game->string;
+	const char *hidden = game->hidden;
+	int len = strlen(hidden);
+	int last = area.hidden_row + area.hidden_rows - 1;
+	for (int row = area.hidden_row; row <= last && len > 0; ++row)
+	{
+		// the characters that fit in the area (a wide one takes two columns)
+		int line = 0, columns = 0;
+		while (line < len && columns + glyph_width(glyph_code(game, (unsigned char) string[line])) <= area.hidden_width)
+			columns += glyph_width(glyph_code(game, (unsigned char) string[line++]));
+		bool cut = line < len && row == last;
+		if (cut)
+		{
+			columns = 0;
+			for (line = 0; columns + glyph_width(glyph_code(game, (unsigned char) string[line])) <= area.hidden_width - 3; ++line)
+				columns += glyph_width(glyph_code(game, (unsigned char) string[line]));
+		}
+		if (line < len)
+		{
+			int end = line;
+			while (end > 0 && hidden[end] != ' ')
+				end--;
+			if (end)
+				line = end;
+		}
+
+		// printed as wide characters, a character not guessed yet takes
+		// as many _ as its columns, so the line does not move
+		wchar_t text[HIDDEN_WIDTH];
+		int count = 0;
+		columns = 0;
+		for (int index = 0; index < line; ++index)
+		{
+			int code = glyph_code(game, (unsigned char) string[index]);
+			int width = glyph_width(code);
+			if (hidden[index] == '_')
+				for (int column = 0; column < width; ++column)
+					text[count++] = L'_';
+			else
+				text[count++] = glyph_upper(code);
+			columns += width;
+		}
+		for (int dot = 0; cut && dot < 3; ++dot, ++columns)
+			text[count++] = L'.';
+		mvwaddnwstr(win, row, area.hidden_right - columns, text, count);
+
+		while (line < len && hidden[line] == ' ')
+			line++;
+		string += line;
+		hidden += line;
+		len -= line;
+	}
+}
+
+// print the mistakes in the mistakes table: "A, B, C" while they fit in
+// it, else without the spaces, and if they still do not fit (wide
+// characters) the ones that fit and a >
+void print_mistakes(WINDOW *win, const data *game)
+{
+	// the mistakes table has a character (in utf-8) and ", " for each one
+	int codes[MISTAKES], count = 0, columns = 0, code;
+	for (const char *mistake = game->mistakes; *mistake && count < MISTAKES; mistake += 2)
+	{
+		int length = glyph_decode(mistake, strlen(mistake), &code);
+		if (!length)
+			break;
+		codes[count++] = code;
+		columns += glyph_width(code);
+		mistake += length;
+	}
+	bool space = count && columns + 2 * (count - 1) <= MISTAKES_WIDTH;
+	bool fits = count && columns + count - 1 <= MISTAKES_WIDTH;
+
+	wchar_t text[3 * MISTAKES + 1];
+	int written = 0;
+	columns = 0;
+	for (int index = 0; index < count; ++index)
+	{
+		int width = glyph_width(codes[index]) + (index ? 1 + space : 0);
+		if (!fits && columns + width + 1 > MISTAKES_WIDTH)
+		{
+			text[written++] = L'>';
+			break;
+		}
+		if (index)
+			text[written++] = L',';
+		if (index && space)
+			text[written++] = L' ';
+		text[written++] = codes[index];
+		columns += width;
+	}
+	mvwprintw(win, area.mistakes_row + 1, area.mistakes_col + 2, "%*s", MISTAKES_WIDTH, "");
+	mvwaddnwstr(win, area.mistakes_row + 1, area.mistakes_col + 2, text, written);
+}
+
+// print a new hangman game (the table without the game data)
+void print_new_game(WINDOW *win)
+{
+	int top = area.gallows_row;
+	wattron(win, COLOR_PAIR(1));
+	box(win, 0, 0);
+	mvwhline(win, 2, 1, '_', COLS - 2);
+	if (area.gallows)
+	{
+		mvwprintw(win, top, 2, "   _________________________________");
+		mvwprintw(win, top + 1, 2, "        []  //                 |");
+		mvwprintw(win, top + 2, 2, "        [] //                  |");
+		mvwprintw(win, top + 3, 2, "        []//                   |");
+		mvwprintw(win, top + 4, 2, "        []/                    |");
+		for (int row = top + 5; row < top + 14; ++row)
+			mvwprintw(win, row, 2, "        []");
+		mvwprintw(win, top + 14, 2, "        []\\");
+		mvwprintw(win, top + 15, 2, "       /[]\\\\");
+		mvwprintw(win, top + 16, 2, "______//[]_\\\\_________");
+		mvwprintw(win, top + 17, 1, "|______________________|");
+	}
+	if (area.help)
+	{
+		int row = area.help_row;
+		mvwprintw(win, row, 1, "______________________________________________");
+		mvwprintw(win, row + 1, 1, "                                              |");
+		mvwprintw(win, row + 2, 2, "Press BACKSPACE to return to the Main Menu.  |");
+		mvwprintw(win, row + 3, 2, "Press a character to see if you guessed      |");
+		mvwprintw(win, row + 4, 2, "a letter in the expression.                  |");
+		mvwprintw(win, row + 5, 1, "                                              |");
+		mvwprintw(win, row + 6, 1, "______________________________________________|");
+	}
+	else
+		print_wrapped(win, area.hint_row, 2, COLS - 4, 1, false, "Press BACKSPACE for the Main Menu.");
+	wattroff(win, COLOR_PAIR(1));
+
+	wattron (win, COLOR_PAIR(4));
+	mvwprintw (win, area.mistakes_row, area.mistakes_col, "| Mistakes Table:|");
+	mvwprintw (win, area.mistakes_row + 1, area.mistakes_col, "|                |");
+	mvwprintw (win, area.mistakes_row + 2, area.mistakes_col, "|________________|");
+	wattroff (win, COLOR_PAIR(4));
+}
+
+// print text from row at col in at most rows lines of at most width
+// columns, broken between words (centered on the line if center is set)
+// returns the rows it took
+int print_wrapped(WINDOW *win, int row, int col, int width, int rows, bool center, const char *text)
+{
+	int taken = 0;
+	while (*text && width > 0 && taken < rows)
+	{
+		// the words that fit, a longer word is cut
+		int line = strlen(text);
+		if (line > width)
+		{
+			line = width;
+			while (line > 0 && text[line] != ' ')
+				line--;
+			if (!line)
+				line = width;
+		}
+		mvwprintw(win, row + taken++, center ? col + (width - line) / 2 : col, "%.*s", line, text);
+		text += line;
+		while (*text == ' ')
+			text++;
+	}
+	return taken;
+}
+
+// print hangman stage (on the gallows, or as a line of text when the
+// gallows does not fit)
+void print_hangman (WINDOW *win, int stage)
+{
+	wattron(win, COLOR_PAIR(4));
+	if (!area.gallows)
+	{
+		mvwprintw(win, area.gallows_row, 2, "Hangman: %d/%d", stage, HANGED);
+		wattroff(win, COLOR_PAIR(4));
+		return;
+	}
+	switch(stage)
+	{
+	case 6:
+		mvwprintw(win, 14, 34, "\\\\");
+		mvwprintw(win, 15, 34, " \\\\");
+		mvwprintw(win, 16, 34, "  \\\\");
+	case 5:
+		mvwprintw(win, 14, 29, "  // ");
+		mvwprintw(win, 15, 29, " //");
+		mvwprintw(win, 16, 29, "//");
+	case 4:
+		mvwprintw(win, 11, 35, "\\\\  ");
+		mvwprintw(win, 12, 35, " \\\\ ");
+		mvwprintw(win, 13, 35, "  \\\\");
+	case 3:
+		mvwprintw(win, 11, 28, "  //");
+		mvwprintw(win, 12, 28, " //");
+		mvwprintw(win, 13, 28, "//");
+	case 2:
+		mvwprintw(win, 11, 32, "[ ]");
+		mvwprintw(win, 12, 32, "[ ]");
+		mvwprintw(win, 13, 32, "[_]");
+	case 1:
+		mvwprintw(win,  7, 29, " ___|___");
+		mvwprintw(win,  8, 29, "// X 0 \\\\");
+		mvwprintw(win,  9, 29, " ]  ^  [");
+		mvwprintw(win, 10, 29, " \\__~__/");;
+		break;
+	}
+	wattroff(win, COLOR_PAIR (4));
+}
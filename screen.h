@@ -0,0 +1,100 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <ncurses.h>
+
+#include "engine.h"
+
+// smallest terminal the screens fit in; the window takes the whole
+// terminal (LINES and COLS of ncurses, they change when it is resized)
+// and the screens are laid out from its size (see place_screens)
+#define MIN_ROWS 12
+#define MIN_COLS 40
+// a terminal where every part is shown at its full size
+#define FULL_ROWS 35
+#define FULL_COLS 120
+// most rows and columns of the hidden string (long expressions are
+// split on more lines, what does not fit ends with ...)
+#define HIDDEN_ROWS 12
+#define HIDDEN_WIDTH 64
+// columns of the mistakes in the mistakes table
+#define MISTAKES_WIDTH 15
+
+// where the parts of the screens are for the size of the terminal; a
+// part that does not fit is printed in a smaller form: the hangman as a
+// line of text, the help box as one line, the titles as plain text
+typedef struct areas
+{
+	// the counters and the clock of the status line
+	bool counters;
+	bool clock;
+	// the gallows (its top row, the line of the hangman without it)
+	bool gallows;
+	int gallows_row;
+	// top left corner of the mistakes table
+	int mistakes_row;
+	int mistakes_col;
+	// the hidden string: first row, rows, columns and the column it is
+	// aligned to on the right
+	int hidden_row;
+	int hidden_rows;
+	int hidden_width;
+	int hidden_right;
+	// the help box (its top row), else a line of help at hint_row
+	bool help;
+	int help_row;
+	int hint_row;
+	// the menu: the big title, the row of the first button and of the
+	// instructions hint
+	bool banner;
+	int title_row;
+	int buttons_row;
+	int menu_hint_row;
+	// the win and lose messages: in big letters, from message_row
+	bool big;
+	int message_row;
+} areas;
+
+extern areas area;
+
+// what was already printed in a match besides the game data
+// (the game data keeps its own CHANGED_* flags)
+typedef struct frame
+{
+	int exprs;
+	int chars;
+	char clock[32];
+} frame;
+
+// the screens that are always the same: each one is printed once in a
+// pad and then copied to the window every time it is shown
+typedef enum screen_id
+{
+	SCREEN_MENU,
+	SCREEN_INSTRUCTIONS,
+	SCREEN_GAME,
+	SCREEN_WIN,
+	SCREEN_LOSE,
+	SCREEN_EMPTY,
+	SCREENS
+} screen_id;
+
+// declare used colors (ncurses)
+void declare_colors();
+
+// cached screens functions
+void place_screens();
+void cache_screen(screen_id which, void (*draw)(WINDOW *win));
+void show_screen(WINDOW *win, screen_id which);
+void resize_screens();
+void free_screens();
+
+// match printing functions
+void print_new_game(WINDOW *win);
+void print_hangman(WINDOW *win, int stage);
+void print_match(WINDOW *win, data *game, vector_string *puzzle, frame *drawn);
+void print_hidden(WINDOW *win, const data *game);
+void print_mistakes(WINDOW *win, const data *game);
+int print_wrapped(WINDOW *win, int row, int col, int width, int rows, bool center, const char *text);
+
+#endif
@@ -0,0 +1,524 @@
+// accept4 and SOCK_NONBLOCK are linux extensions
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "engine.h"
+#include "probe.h"
+
+// hangman-server: one database for many players; every connection is a
+// session with its own game, served by a single epoll loop
+//
+// the protocol is made of lines, the client sends commands:
+//   NEW          start a match
+//   GUESS <c>    try a character (in utf-8) in the match
+//   STATE        show the match again
+//   QUIT         close the session
+// and every command gets one line back:
+//   <event> <status> <score> <stage> <tried> <hidden>
+// event is new, hit, miss, same (already tried) or state, status is
+// running, won or lost, tried are the mistakes ("-" for none) and hidden
+// is the hidden string (last, it has spaces); errors are "error <why>"
+
+// longest command a client can send
+#define LINE 64
+// events handled in an iteration of the loop
+#define EVENTS 256
+// connections waiting to be accepted
+#define BACKLOG 4096
+// milliseconds the connections wait when the server is out of
+// descriptors, if no session closes before
+#define PAUSE 100
+
+// a connection: the game is made when the first match starts, and the
+// replies the client did not take yet are kept until it can
+typedef struct session
+{
+	int fd;
+	data *game;
+	char line[LINE];
+	int length;
+	// the line is too long, the rest of it is skipped
+	bool skip;
+	char *pending;
+	size_t sent;
+	size_t waiting;
+} session;
+
+// declaration of the functions used by the server
+int listen_unix(const char *path);
+int listen_tcp(int port);
+void serve(int listener);
+void accept_sessions(int listener);
+void pause_sessions(bool pause);
+void read_session(session *client);
+void command(session *client, char *line);
+void reply(session *client, const char *event);
+void send_session(session *client, const char *text, size_t size);
+void flush_session(session *client);
+void close_session(session *client);
+void stop(int signal);
+
+// the database shared by the sessions (only read once it is loaded)
+vector_string *puzzle;
+int events;
+// the listener, and if it is left out of the loop for now
+int listening;
+bool paused;
+volatile sig_atomic_t stopped;
+unsigned long long seed;
+int sessions;
+
+// the main function of the server
+int main(int argc, char *const argv[])
+{
+	PROBE_INIT();
+
+	const char *path = NULL;
+	int port = 0;
+
+	int option;
+	while ((option = getopt(argc, argv, "u:p:")) != -1)
+	{
+		switch (option)
+		{
+		case 'u':
+			path = optarg;
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+
+	if (optind >= argc || (path && port) || port < 0 || port > 65535)
+	{
+		fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman-server [-u <socket> | -p <port>] [<input-file-1> ...]\n\n");
+		return FAILURE;
+	}
+	if (!path && !port)
+		path = "hangman.sock";
+
+	// create the word | expression database once for every session
+	puzzle = database_create();
+	int files[argc];
+	for (int index = optind; index < argc; ++index)
+	{
+		files[index - optind] = open(argv[index], O_RDONLY);
+		if (files[index - optind] < 0)
+		{
+			fprintf(stderr, "[Error] File %s failed to open\n\n", argv[index]);
+			return FAILURE;
+		}
+	}
+	int failed = database_store_files(puzzle, files, argc - optind, 0);
+	for (int index = 0; index < argc - optind; ++index)
+		close(files[index]);
+	if (failed >= 0)
+	{
+		fprintf(stderr, "[Error] Could not parse the file %s\n\n", argv[optind + failed]);
+		return FAILURE;
+	}
+	if (!puzzle->count)
+	{
+		fprintf(stderr, "[Error] No expressions to play\n\n");
+		return FAILURE;
+	}
+
+	// a descriptor for each session, as many as allowed
+	struct rlimit limit;
+	if (!getrlimit(RLIMIT_NOFILE, &limit))
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	// stop on ctrl-c, the clients that leave are seen by send
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	int listener = path ? listen_unix(path) : listen_tcp(port);
+	seed = time(NULL);
+	printf("hangman-server: %d expressions on %s", puzzle->count, path ? path : "127.0.0.1");
+	if (!path)
+		printf(":%d", port);
+	printf("\n");
+	fflush(stdout);
+
+	serve(listener);
+
+	close(listener);
+	if (path)
+		unlink(path);
+	database_destroy(puzzle);
+	return SUCCESS;
+}
+
+// listen on a unix domain socket (an old one at the path is replaced)
+int listen_unix(const char *path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "[Error] The socket path %s is too long\n\n", path);
+		exit(FAILURE);
+	}
+	strcpy(address.sun_path, path);
+	unlink(path);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener < 0 || bind(listener, (struct sockaddr *) &address, sizeof(address)) ||
+		listen(listener, BACKLOG))
+	{
+		fprintf(stderr, "[Error] Could not listen on %s\n\n", path);
+		exit(FAILURE);
+	}
+	return listener;
+}
+
+// listen on a tcp port of the loopback interface
+int listen_tcp(int port)
+{
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int reuse = 1;
+	int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener < 0 || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) ||
+		bind(listener, (struct sockaddr *) &address, sizeof(address)) || listen(listener, BACKLOG))
+	{
+		fprintf(stderr, "[Error] Could not listen on port %d\n\n", port);
+		exit(FAILURE);
+	}
+	return listener;
+}
+
+// the event loop: new connections and commands of the sessions
+void serve(int listener)
+{
+	listening = listener;
+	events = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event event = {EPOLLIN, {.ptr = NULL}};
+	if (events < 0 || epoll_ctl(events, EPOLL_CTL_ADD, listener, &event))
+	{
+		fprintf(stderr, "[Error] Could not wait for the connections\n\n");
+		exit(FAILURE);
+	}
+
+	struct epoll_event ready[EVENTS];
+	while (!stopped)
+	{
+		int count = epoll_wait(events, ready, EVENTS, paused ? PAUSE : -1);
+		if (!count && paused)
+			pause_sessions(false);
+		for (int index = 0; index < count; ++index)
+		{
+			session *client = (session *) ready[index].data.ptr;
+			if (!client)
+				accept_sessions(listener);
+			else if (ready[index].events & (EPOLLERR | EPOLLHUP) && !(ready[index].events & EPOLLIN))
+				close_session(client);
+			else if (ready[index].events & EPOLLOUT)
+				flush_session(client);
+			else
+				read_session(client);
+
+			// a closed session is freed once nothing uses it
+			if (client && client->fd < 0)
+				free(client);
+		}
+	}
+	close(events);
+}
+
+// take every connection waiting
+void accept_sessions(int listener)
+{
+	while (true)
+	{
+		int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0)
+		{
+			// a signal, or a connection that left before it was taken
+			if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
+				continue;
+			// out of descriptors (or memory): the listener stays readable,
+			// so it waits outside the loop instead of spinning in it
+			if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+				pause_sessions(true);
+			// EAGAIN: no more connections
+			return;
+		}
+
+		session *client = (session *) calloc(1, sizeof(session));
+		if (!client)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		client->fd = fd;
+
+		struct epoll_event event = {EPOLLIN, {.ptr = client}};
+		if (epoll_ctl(events, EPOLL_CTL_ADD, fd, &event))
+		{
+			close(fd);
+			free(client);
+			continue;
+		}
+		sessions++;
+	}
+}
+
+// leave the listener out of the loop (the connections wait in the
+// backlog) or put it back, when a session closes or after PAUSE
+void pause_sessions(bool pause)
+{
+	if (pause == paused)
+		return;
+	struct epoll_event event = {pause ? 0 : EPOLLIN, {.ptr = NULL}};
+	epoll_ctl(events, EPOLL_CTL_MOD, listening, &event);
+	paused = pause;
+}
+
+// read the commands a client sent, each complete line is run
+void read_session(session *client)
+{
+	char buffer[4096];
+	ssize_t size = recv(client->fd, buffer, sizeof(buffer), 0);
+	if (size == 0 || (size < 0 && errno != EAGAIN && errno != EINTR))
+	{
+		close_session(client);
+		return;
+	}
+
+	for (ssize_t index = 0; index < size && client->fd >= 0; ++index)
+	{
+		if (buffer[index] == '\n')
+		{
+			client->line[client->length] = '\0';
+			if (client->skip)
+				reply(client, "error line too long");
+			else
+				command(client, client->line);
+			client->length = 0;
+			client->skip = false;
+		}
+		else if (client->length < LINE - 1)
+			client->line[client->length++] = buffer[index];
+		else
+			client->skip = true;
+	}
+}
+
+// run a command of a client
+void command(session *client, char *line)
+{
+	// the words of the command, a \r at the end is not part of it
+	size_t size = strlen(line);
+	if (size && line[size - 1] == '\r')
+		line[size - 1] = '\0';
+	char *name = strtok(line, " ");
+	char *argument = strtok(NULL, " ");
+	int code, length;
+
+	if (!name)
+		reply(client, "error empty command");
+	else if (!strcasecmp(name, "NEW"))
+	{
+		if (!client->game)
+		{
+			client->game = game_create();
+			client->game->seed = seed ^ (unsigned long long) client->fd << 32 ^ (unsigned long long) sessions;
+		}
+
+		// the pool of the database is not changed, it is shared by
+		// every session: an expression can come again
+		start_expression(client->game, puzzle, random_next(&client->game->seed) % puzzle->count);
+		reply(client, "new");
+	}
+	else if (!strcasecmp(name, "GUESS"))
+	{
+		if (!client->game || game_status(client->game) != RUNNING)
+			reply(client, "error no match is running");
+		else if (!argument || !(length = glyph_decode(argument, strlen(argument), &code)) ||
+			argument[length] || !glyph_width(code))
+			reply(client, "error guess one character");
+		else
+		{
+			int found = guess_character(client->game, code);
+			reply(client, found == 1 ? "hit" : found == -1 ? "miss" : "same");
+		}
+	}
+	else if (!strcasecmp(name, "STATE"))
+	{
+		if (!client->game)
+			reply(client, "error no match was started");
+		else
+			reply(client, "state");
+	}
+	else if (!strcasecmp(name, "QUIT"))
+		close_session(client);
+	else
+		reply(client, "error unknown command");
+}
+
+// send a line with the event and the state of the match of a client
+// (only the event for errors)
+void reply(session *client, const char *event)
+{
+	if (client->fd < 0)
+		return;
+
+	data *game = client->game;
+	if (!strncmp(event, "error", 5))
+	{
+		char text[LINE];
+		int size = snprintf(text, sizeof(text), "%s\n", event);
+		send_session(client, text, size);
+		return;
+	}
+
+	// the mistakes in the order they were tried (each one is followed
+	// by ", " in the table)
+	char tried[MISTAKES_SIZE + 1];
+	int count = 0, code;
+	for (const char *mistake = game->mistakes; *mistake; )
+	{
+		int length = glyph_decode(mistake, strlen(mistake), &code);
+		if (!length)
+			break;
+		memcpy(tried + count, mistake, length);
+		count += length;
+		mistake += length + 2;
+	}
+	if (!count)
+		tried[count++] = '-';
+	tried[count] = '\0';
+
+	// the hidden string is sent in utf-8 (4 bytes at most for each
+	// character), after the rest of the line
+	int status = game_status(game);
+	int hidden = strlen(game->hidden);
+	char small[512];
+	char *text = 4 * (size_t) hidden + MISTAKES_SIZE + 64 < sizeof(small) ? small : (char *) malloc(4 * (size_t) hidden + MISTAKES_SIZE + 64);
+	if (!text)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	int size = sprintf(text, "%s %s %d %d %s ", event,
+		status == RUNNING ? "running" : status == SUCCESS ? "won" : "lost",
+		game->score, game->stage, tried);
+	size += glyph_text(&game->glyphs, game->hidden, hidden, text + size, true);
+	text[size++] = '\n';
+	send_session(client, text, size);
+	if (text != small)
+		free(text);
+}
+
+// send text to a client, what it can not take now is kept for later
+void send_session(session *client, const char *text, size_t size)
+{
+	size_t sent = 0;
+	if (!client->waiting)
+	{
+		ssize_t written = send(client->fd, text, size, MSG_NOSIGNAL);
+		if (written < 0 && errno != EAGAIN && errno != EINTR)
+		{
+			close_session(client);
+			return;
+		}
+		sent = written > 0 ? written : 0;
+		if (sent == size)
+			return;
+	}
+
+	// keep the rest and stop reading commands until it is sent
+	char *aux = (char *) realloc(client->pending, client->waiting + size - sent);
+	if (!aux)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	client->pending = aux;
+	memcpy(client->pending + client->waiting, text + sent, size - sent);
+	if (!client->waiting)
+	{
+		struct epoll_event event = {EPOLLOUT, {.ptr = client}};
+		epoll_ctl(events, EPOLL_CTL_MOD, client->fd, &event);
+	}
+	client->waiting += size - sent;
+}
+
+// send the replies a client did not take yet
+void flush_session(session *client)
+{
+	ssize_t written = send(client->fd, client->pending + client->sent, client->waiting - client->sent, MSG_NOSIGNAL);
+	if (written < 0 && errno != EAGAIN && errno != EINTR)
+	{
+		close_session(client);
+		return;
+	}
+	client->sent += written > 0 ? written : 0;
+	if (client->sent < client->waiting)
+		return;
+
+	// everything was sent, read the commands again
+	free(client->pending);
+	client->pending = NULL;
+	client->sent = client->waiting = 0;
+	struct epoll_event event = {EPOLLIN, {.ptr = client}};
+	epoll_ctl(events, EPOLL_CTL_MOD, client->fd, &event);
+}
+
+// close the connection of a client; the session itself is freed by the
+// event loop (fd is -1 from now on)
+void close_session(session *client)
+{
+	if (client->fd < 0)
+		return;
+	epoll_ctl(events, EPOLL_CTL_DEL, client->fd, NULL);
+	close(client->fd);
+	client->fd = -1;
+	if (client->game)
+		game_destroy(client->game);
+	client->game = NULL;
+	free(client->pending);
+	client->pending = NULL;
+	sessions--;
+
+	// a descriptor is free for a waiting connection
+	pause_sessions(false);
+}
+
+// stop serving at the next event
+void stop(int signal)
+{
+	stopped = 1;
+}
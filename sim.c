@@ -0,0 +1,494 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "engine.h"
+#include "probe.h"
+#include "solver.h"
+
+// headless driver: plays games at machine speed against a guessing
+// strategy and reports how fast and how well they were played
+
+// order in which the frequency strategy tries the characters
+#define FREQUENCIES "etaoinshrdlcumwfgypbvkjxqz"
+// expressions in a unit of work of the parallel simulation
+#define CHUNK 256
+
+// a strategy that can be chosen from the command line
+typedef struct solver
+{
+	const char *name;
+	strategy guess;
+} solver;
+
+// what the strategies of a thread know besides the game
+typedef struct player
+{
+	unsigned long long rng;
+	solver_state *solver;
+} player;
+
+// statistics of the games played by a thread
+typedef struct stats
+{
+	long games;
+	long wins;
+	long mistakes;
+	long guesses;
+	long steals;
+} stats;
+
+// a thread of the parallel simulation; it owns the chunks [head, tail)
+// packed in range, so the owner (from the head) and the thieves (from
+// the tail) can take chunks with a single compare and swap
+typedef struct worker
+{
+	_Alignas(64) _Atomic unsigned long long range;
+	pthread_t thread;
+	int id;
+	// only written by its thread, merged when all of them finished
+	stats result;
+} worker;
+
+// declaration of the functions used by the simulation
+int guess_frequency(const data *game, void *state);
+int guess_random(const data *game, void *state);
+int guess_optimal(const data *game, void *state);
+int guess_fallback(const data *game);
+int play(data *game, player *self);
+void parse_range(const char *text, int bounds[2]);
+void simulate_random(long games);
+void simulate_parallel();
+void *simulate(void *argument);
+long take_chunk(worker *self);
+long steal_chunk(worker *self);
+void print_hardest(int hardest);
+void print_stats(stats *total, double seconds);
+double elapsed(struct timespec *begin);
+
+// all the known strategies, the first one is the default
+solver solvers[] = {
+	{"frequency", guess_frequency},
+	{"random", guess_random},
+	{"optimal", guess_optimal},
+};
+
+// options and data shared by the simulation
+solver *chosen;
+vector_string *puzzle;
+unsigned long long seed;
+// buckets the random games are chosen from (filtered is NULL when no
+// bound is given, then any expression is drawn from the pool)
+selection filter;
+const selection *filtered;
+// the expressions by shape, for the optimal strategy
+solver_index *oracle;
+// parallel simulation: every expression is played rounds times and
+// the results of each one are kept to rank them by difficulty
+worker *workers;
+int threads;
+long rounds;
+unsigned int *lost;
+unsigned int *errors;
+
+// the main function of the simulation
+int main(int argc, char *const argv[])
+{
+	PROBE_INIT();
+
+	long games = 100000;
+	int hardest = 10;
+	chosen = &solvers[0];
+	rounds = 1;
+
+	int option;
+	while ((option = getopt(argc, argv, "g:s:j:r:k:l:w:d:")) != -1)
+	{
+		switch (option)
+		{
+		case 'g':
+			games = atol(optarg);
+			break;
+		case 's':
+			chosen = NULL;
+			for (int index = 0; index < sizeof(solvers) / sizeof(solver); ++index)
+				if (!strcmp(optarg, solvers[index].name))
+					chosen = &solvers[index];
+			if (!chosen)
+			{
+				fprintf(stderr, "[Error] Unknown strategy %s\n\n", optarg);
+				return FAILURE;
+			}
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			if (threads <= 0)
+				threads = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
+		case 'r':
+			rounds = atol(optarg);
+			break;
+		case 'k':
+			hardest = atoi(optarg);
+			break;
+		case 'l':
+			parse_range(optarg, filter.length);
+			filtered = &filter;
+			break;
+		case 'w':
+			parse_range(optarg, filter.words);
+			filtered = &filter;
+			break;
+		case 'd':
+			parse_range(optarg, filter.distinct);
+			filtered = &filter;
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+
+	if (optind >= argc || games <= 0 || rounds <= 0)
+	{
+		fprintf(stderr, "[Error] Not enough arguments\n\n\tUsage:\t$./hangman-sim [-g <games>] [-l|-w|-d <min>[-<max>]] [-s frequency|random|optimal] [-j <threads> [-r <rounds>] [-k <hardest>]] [<input-file-1> ...]\n\n");
+		return FAILURE;
+	}
+
+	seed = time(NULL);
+	puzzle = database_create();
+
+	// create the word | expression database, the files are parsed
+	// at the same time
+	int files[argc];
+	for (int index = optind; index < argc; ++index)
+	{
+		files[index - optind] = open(argv[index], O_RDONLY);
+		if (files[index - optind] < 0)
+		{
+			fprintf(stderr, "[Error] File %s failed to open\n\n", argv[index]);
+			return FAILURE;
+		}
+	}
+	int failed = database_store_files(puzzle, files, argc - optind, 0);
+	for (int index = 0; index < argc - optind; ++index)
+		close(files[index]);
+	if (failed >= 0)
+	{
+		fprintf(stderr, "[Error] Could not parse the file %s\n\n", argv[optind + failed]);
+		return FAILURE;
+	}
+	if (!database_available(puzzle, filtered))
+	{
+		fprintf(stderr, "[Error] No expressions to play\n\n");
+		return FAILURE;
+	}
+
+	if (chosen->guess == guess_optimal)
+		oracle = solver_create(puzzle);
+
+	if (threads)
+	{
+		simulate_parallel();
+		print_hardest(hardest);
+	}
+	else
+		simulate_random(games);
+
+	if (oracle)
+		solver_destroy(oracle);
+	database_destroy(puzzle);
+	return SUCCESS;
+}
+
+// play the started match of game until it ends
+// returns the number of characters tried
+int play(data *game, player *self)
+{
+	// every character can be tried once, so a match that lasts
+	// longer means the strategy repeats itself
+	int moves = 0;
+	while (game_status(game) == RUNNING && moves++ < CHARSET)
+		guess_character(game, glyph_code(game, chosen->guess(game, self)));
+	return moves;
+}
+
+// bounds of a bucket filter: "5" is only 5, "5-8" from 5 to 8, "5-" from
+// 5 up and "-8" up to 8
+void parse_range(const char *text, int bounds[2])
+{
+	const char *dash = strchr(text, '-');
+	bounds[0] = text[0] == '-' ? 0 : atoi(text);
+	bounds[1] = dash ? atoi(dash + 1) : bounds[0];
+}
+
+// play games with random expressions, like a player would
+void simulate_random(long games)
+{
+	data *game = game_create();
+	player self = {seed, oracle ? solver_state_create(oracle) : NULL};
+	game->seed = seed;
+
+	stats total = {0};
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	for (total.games = 0; total.games < games; ++total.games)
+	{
+		// when the database is drained start all over again
+		if (start_selection(game, puzzle, filtered) != SUCCESS)
+		{
+			database_reset(puzzle);
+			start_selection(game, puzzle, filtered);
+		}
+
+		total.guesses += play(game, &self);
+		total.wins += game_status(game) == SUCCESS;
+		total.mistakes += game->stage;
+	}
+
+	print_stats(&total, elapsed(&begin));
+	if (self.solver)
+		solver_state_destroy(self.solver);
+	game_destroy(game);
+}
+
+// play every expression rounds times on more threads; the chunks of
+// expressions are split evenly and idle threads steal from busy ones
+void simulate_parallel()
+{
+	long chunks = (puzzle->count + CHUNK - 1) / CHUNK;
+	lost = (unsigned int *) calloc(puzzle->count, sizeof(unsigned int));
+	errors = (unsigned int *) calloc(puzzle->count, sizeof(unsigned int));
+	workers = (worker *) aligned_alloc(_Alignof(worker), sizeof(worker) * threads);
+	if (!lost || !errors || !workers)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	for (int index = 0; index < threads; ++index)
+	{
+		unsigned long long head = chunks * index / threads;
+		unsigned long long tail = chunks * (index + 1) / threads;
+		atomic_init(&workers[index].range, head << 32 | tail);
+		workers[index].id = index;
+		memset(&workers[index].result, 0, sizeof(stats));
+	}
+	for (int index = 0; index < threads; ++index)
+		if (pthread_create(&workers[index].thread, NULL, simulate, &workers[index]))
+		{
+			fprintf(stderr, "[Error] Could not start a thread\n");
+			exit(FAILURE);
+		}
+
+	// merge the statistics of every thread
+	stats total = {0};
+	for (int index = 0; index < threads; ++index)
+	{
+		pthread_join(workers[index].thread, NULL);
+		total.games += workers[index].result.games;
+		total.wins += workers[index].result.wins;
+		total.mistakes += workers[index].result.mistakes;
+		total.guesses += workers[index].result.guesses;
+		total.steals += workers[index].result.steals;
+	}
+
+	print_stats(&total, elapsed(&begin));
+	printf("threads:     %d (%ld chunks stolen)\n", threads, total.steals);
+	free(workers);
+}
+
+// a thread of the parallel simulation
+void *simulate(void *argument)
+{
+	worker *self = (worker *) argument;
+	data *game = game_create();
+
+	// every thread has its own random numbers and solver state
+	player me = {seed + self->id, oracle ? solver_state_create(oracle) : NULL};
+	game->seed = random_next(&me.rng);
+
+	long chunk;
+	while ((chunk = take_chunk(self)) >= 0 || (chunk = steal_chunk(self)) >= 0)
+	{
+		int last = (chunk + 1) * CHUNK < puzzle->count ? (chunk + 1) * CHUNK : puzzle->count;
+
+		// each expression is in a single chunk, so its results are
+		// only written by the thread that took the chunk
+		for (int index = chunk * CHUNK; index < last; ++index)
+			for (long round = 0; round < rounds; ++round)
+			{
+				start_expression(game, puzzle, index);
+				self->result.guesses += play(game, &me);
+				self->result.games++;
+				self->result.mistakes += game->stage;
+				errors[index] += game->stage;
+				if (game_status(game) == SUCCESS)
+					self->result.wins++;
+				else
+					lost[index]++;
+			}
+	}
+
+	if (me.solver)
+		solver_state_destroy(me.solver);
+	game_destroy(game);
+	return NULL;
+}
+
+// take the first chunk of the worker, -1 if it has none
+long take_chunk(worker *self)
+{
+	unsigned long long range = atomic_load(&self->range);
+	while ((range >> 32) < (range & 0xFFFFFFFF))
+		if (atomic_compare_exchange_weak(&self->range, &range, range + (1ULL << 32)))
+			return range >> 32;
+	return -1;
+}
+
+// steal half of the chunks of another worker, keep them and return the
+// first one; -1 if there is no work left
+long steal_chunk(worker *self)
+{
+	for (int offset = 1; offset < threads; ++offset)
+	{
+		worker *victim = &workers[(self->id + offset) % threads];
+		unsigned long long range = atomic_load(&victim->range);
+		while ((range >> 32) < (range & 0xFFFFFFFF))
+		{
+			unsigned long long head = range >> 32, tail = range & 0xFFFFFFFF;
+			unsigned long long split = tail - (tail - head + 1) / 2;
+			if (atomic_compare_exchange_weak(&victim->range, &range, head << 32 | split))
+			{
+				self->result.steals++;
+				atomic_store(&self->range, (split + 1) << 32 | tail);
+				return split;
+			}
+		}
+	}
+	return -1;
+}
+
+// print the expressions lost the most (ties broken by mistakes)
+void print_hardest(int hardest)
+{
+	if (hardest > puzzle->count)
+		hardest = puzzle->count;
+	if (hardest <= 0)
+		return;
+
+	// keep the hardest ones sorted while scanning the database once
+	int *top = (int *) malloc(sizeof(int) * hardest);
+	int found = 0;
+	for (int index = 0; index < puzzle->count; ++index)
+	{
+		int position = found < hardest ? found++ : hardest;
+		while (position > 0 && (lost[top[position - 1]] < lost[index] ||
+			(lost[top[position - 1]] == lost[index] && errors[top[position - 1]] < errors[index])))
+		{
+			if (position < hardest)
+				top[position] = top[position - 1];
+			position--;
+		}
+		if (position < hardest)
+			top[position] = index;
+	}
+
+	// the expressions are written in utf-8 on the heap, they can be of
+	// any length
+	printf("hardest:\n");
+	char *text = NULL;
+	for (int index = 0; index < found; ++index)
+	{
+		entry *chosen = &puzzle->entries[top[index]];
+		char *aux = (char *) realloc(text, 4 * (size_t) chosen->size + 1);
+		if (!aux)
+		{
+			fprintf(stderr, "[Error] Not enough memory.\n");
+			exit(FAILURE);
+		}
+		text = aux;
+		glyph_text(&puzzle->glyphs, puzzle->arena + chosen->offset, chosen->size, text, false);
+		printf("  %6.2f%% lost  %5.2f mistakes  %s\n",
+			100.0 * lost[top[index]] / rounds, (double) errors[top[index]] / rounds, text);
+	}
+	free(text);
+	free(top);
+	free(lost);
+	free(errors);
+}
+
+// print the statistics of the games played
+void print_stats(stats *total, double seconds)
+{
+	printf("strategy:    %s\n", chosen->name);
+	printf("expressions: %d (%d duplicates left out)\n", puzzle->count, puzzle->duplicates);
+	if (puzzle->overflows)
+		printf("left out:    %d files, their characters did not fit in the alphabet (%d characters besides ascii)\n",
+			puzzle->overflows, GLYPHS);
+	printf("games:       %ld\n", total->games);
+	printf("wins:        %ld (%.2f%%)\n", total->wins, 100.0 * total->wins / total->games);
+	printf("mistakes:    %.3f per game\n", (double) total->mistakes / total->games);
+	printf("guesses:     %.3f per game\n", (double) total->guesses / total->games);
+	printf("time:        %.3f s\n", seconds);
+	printf("throughput:  %.0f games/sec\n", total->games / seconds);
+}
+
+// try the most used english letters first
+int guess_frequency(const data *game, void *state)
+{
+	for (const char *ch = FREQUENCIES; *ch; ++ch)
+		if (!charset_has(&game->shown, *ch) && !charset_has(&game->tried, *ch))
+			return *ch;
+	return guess_fallback(game);
+}
+
+// try a random letter that was not tried yet
+int guess_random(const data *game, void *state)
+{
+	int start = random_next(&((player *) state)->rng) % 26;
+	for (int index = 0; index < 26; ++index)
+	{
+		int ch = 'a' + (start + index) % 26;
+		if (!charset_has(&game->shown, ch) && !charset_has(&game->tried, ch))
+			return ch;
+	}
+	return guess_fallback(game);
+}
+
+// the character that tells the most about the expressions that still
+// fit the hidden string
+int guess_optimal(const data *game, void *state)
+{
+	int ch = solver_guess(((player *) state)->solver, game);
+	return ch >= 0 ? ch : guess_frequency(game, state);
+}
+
+// when all the letters were tried, try the rest of the printable characters
+// (then the ones of the database that are not ascii)
+int guess_fallback(const data *game)
+{
+	for (int ch = '!'; ch < GLYPH + game->source->count; ++ch)
+		if ((ch >= GLYPH || (isprint(ch) && !isupper(ch))) &&
+			!charset_has(&game->shown, ch) && !charset_has(&game->tried, ch))
+			return ch;
+	return ' ';
+}
+
+// seconds passed since begin
+double elapsed(struct timespec *begin)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - begin->tv_sec) + (now.tv_nsec - begin->tv_nsec) / 1e9;
+}
@@ -0,0 +1,480 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "engine.h"
+#include "probe.h"
+#include "solver.h"
+
+// declaration of the functions used by the solver
+unsigned long long shape_key(const char *string, int length);
+bool shape_fits(const char *a, const char *b, int length);
+int shape_find(const solver_index *index, const char *string, int length);
+void shape_build(const solver_index *index, shape *current);
+void solver_restart(solver_state *state, const data *game);
+void solver_and(solver_state *state, const unsigned long long *bits, bool complement);
+void solver_compact(solver_state *state);
+void solver_narrow(solver_state *state, const data *game);
+bool solver_fits(const char *string, const data *game, int length);
+void solver_patterns(solver_state *state, const data *game, int candidates);
+double solver_split(solver_state *state, int ch, int candidates, int *found);
+
+// hash of the shape of an expression (its length and its spaces)
+unsigned long long shape_key(const char *string, int length)
+{
+	unsigned long long hash = 0xCBF29CE484222325ULL ^ length;
+	for (int index = 0; index < length; ++index)
+		if (string[index] == ' ')
+			hash = (hash ^ index) * 0x100000001B3ULL;
+	return hash;
+}
+
+// if two strings of the same length have the spaces in the same places
+bool shape_fits(const char *a, const char *b, int length)
+{
+	for (int index = 0; index < length; ++index)
+		if ((a[index] == ' ') != (b[index] == ' '))
+			return false;
+	return true;
+}
+
+// shape of a string (an expression or a hidden string), -1 if none
+int shape_find(const solver_index *index, const char *string, int length)
+{
+	unsigned long long key = shape_key(string, length);
+	for (int slot = key & (index->size - 1); index->table[slot] >= 0; slot = (slot + 1) & (index->size - 1))
+	{
+		const shape *current = &index->shapes[index->table[slot]];
+		const entry *first = &index->puzzle->entries[current->members[0]];
+		if (current->key == key && current->length == length &&
+			shape_fits(string, index->puzzle->arena + first->offset, length))
+			return index->table[slot];
+	}
+	return -1;
+}
+
+// group the expressions of the database by shape and index them
+solver_index *solver_create(const vector_string *puzzle)
+{
+	solver_index *index = (solver_index *) calloc(1, sizeof(solver_index));
+	int *shape_of = (int *) malloc(sizeof(int) * (puzzle->count ? puzzle->count : 1));
+	if (!index || !shape_of)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	index->puzzle = puzzle;
+
+	// a table at most half full
+	index->size = 16;
+	while (index->size < 2 * puzzle->count)
+		index->size *= 2;
+	index->table = (int *) malloc(sizeof(int) * index->size);
+	index->members = (int *) malloc(sizeof(int) * (puzzle->count ? puzzle->count : 1));
+	int capacity = 16;
+	index->shapes = (shape *) malloc(sizeof(shape) * capacity);
+	if (!index->table || !index->members || !index->shapes)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	memset(index->table, -1, sizeof(int) * index->size);
+
+	// find the shape of every expression, the first one of a shape is
+	// kept as its member until the members are placed
+	for (int expression = 0; expression < puzzle->count; ++expression)
+	{
+		const entry *current = &puzzle->entries[expression];
+		const char *string = puzzle->arena + current->offset;
+		int which = shape_find(index, string, current->size);
+		if (which < 0)
+		{
+			if (index->count == capacity)
+			{
+				shape *aux = (shape *) realloc(index->shapes, sizeof(shape) * 2 * capacity);
+				if (!aux)
+				{
+					fprintf(stderr, "[Error] Not enough memory.\n");
+					exit(FAILURE);
+				}
+				index->shapes = aux;
+				capacity *= 2;
+			}
+			shape *added = &index->shapes[index->count];
+			memset(added, 0, sizeof(shape));
+			added->key = shape_key(string, current->size);
+			added->length = current->size;
+			added->members = &index->members[expression];
+			index->members[expression] = expression;
+
+			int slot = added->key & (index->size - 1);
+			while (index->table[slot] >= 0)
+				slot = (slot + 1) & (index->size - 1);
+			which = index->table[slot] = index->count++;
+		}
+
+		shape *found = &index->shapes[which];
+		found->count++;
+		for (int word = 0; word < CHARSET / 64; ++word)
+			found->letters.bits[word] |= current->letters.bits[word];
+		shape_of[expression] = which;
+	}
+
+	// place the members of every shape one after another
+	int placed = 0;
+	for (int current = 0; current < index->count; ++current)
+	{
+		index->shapes[current].members = index->members + placed;
+		placed += index->shapes[current].count;
+		index->shapes[current].count = 0;
+	}
+	for (int expression = 0; expression < puzzle->count; ++expression)
+	{
+		shape *found = &index->shapes[shape_of[expression]];
+		found->members[found->count++] = expression;
+	}
+	free(shape_of);
+
+	for (int current = 0; current < index->count; ++current)
+	{
+		shape_build(index, &index->shapes[current]);
+		if (index->shapes[current].words > index->words)
+			index->words = index->shapes[current].words;
+		if (index->shapes[current].rows > index->rows)
+			index->rows = index->shapes[current].rows;
+	}
+	return index;
+}
+
+// make the rows of the characters of a shape and, for a large shape,
+// the bitsets of its members
+void shape_build(const solver_index *index, shape *current)
+{
+	memset(current->row, NO_ROW, sizeof(current->row));
+	current->rows = 0;
+	for (int ch = '!'; ch < CHARSET; ++ch)
+		if (charset_has(&current->letters, ch))
+			current->row[ch] = current->rows++;
+	current->words = (current->count + 63) / 64;
+	if (current->count <= SMALL_SHAPE)
+		return;
+
+	// (a shape of spaces only has no rows, one is kept anyway)
+	size_t row = current->words;
+	current->contains = (unsigned long long *) calloc(row * (current->rows + 1), sizeof(unsigned long long));
+	current->at = (unsigned long long *) calloc(row * (current->rows + 1) * current->length, sizeof(unsigned long long));
+	if (!current->contains || !current->at)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	PROBE_COUNT(COUNTER_ALLOCATIONS, 2);
+	PROBE_COUNT(COUNTER_ALLOCATED, sizeof(unsigned long long) * row * (current->rows + 1) * (current->length + 1));
+
+	for (int member = 0; member < current->count; ++member)
+	{
+		const entry *expression = &index->puzzle->entries[current->members[member]];
+		const char *string = index->puzzle->arena + expression->offset;
+		unsigned long long bit = 1ULL << (member & 63);
+		for (int position = 0; position < current->length; ++position)
+		{
+			if (string[position] == ' ')
+				continue;
+			size_t which = current->row[(unsigned char) string[position] % CHARSET];
+			current->contains[which * row + member / 64] |= bit;
+			current->at[(position * current->rows + which) * row + member / 64] |= bit;
+		}
+	}
+}
+
+void solver_destroy(solver_index *index)
+{
+	for (int current = 0; current < index->count; ++current)
+	{
+		free(index->shapes[current].contains);
+		free(index->shapes[current].at);
+	}
+	free(index->shapes);
+	free(index->members);
+	free(index->table);
+	free(index);
+}
+
+// a player for the matches of one thread
+solver_state *solver_state_create(const solver_index *index)
+{
+	solver_state *state = (solver_state *) calloc(1, sizeof(solver_state));
+	if (!state)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	int words = index->words ? index->words : 1;
+	state->candidates = (unsigned long long *) malloc(sizeof(unsigned long long) * words);
+	state->active = (int *) malloc(sizeof(int) * words);
+	state->patterns = (unsigned long long *) malloc(sizeof(unsigned long long) * EXACT_SPLIT * (index->rows + 1));
+	if (!state->candidates || !state->active || !state->patterns)
+	{
+		fprintf(stderr, "[Error] Not enough memory.\n");
+		exit(FAILURE);
+	}
+	state->index = index;
+	state->shape = -1;
+	state->match = -1;
+	return state;
+}
+
+void solver_state_destroy(solver_state *state)
+{
+	free(state->patterns);
+	free(state->active);
+	free(state->candidates);
+	free(state);
+}
+
+// start with every member of the shape of the hidden string
+void solver_restart(solver_state *state, const data *game)
+{
+	int length = strlen(game->hidden);
+	state->shape = shape_find(state->index, game->hidden, length);
+	state->match = game->index;
+	state->actives = 0;
+	memset(&state->shown, 0, sizeof(charset));
+	memset(&state->tried, 0, sizeof(charset));
+	if (state->shape < 0)
+		return;
+
+	const shape *current = &state->index->shapes[state->shape];
+	memset(state->candidates, 0xFF, sizeof(unsigned long long) * current->words);
+	if (current->count & 63)
+		state->candidates[current->words - 1] = (1ULL << (current->count & 63)) - 1;
+	for (int word = 0; word < current->words; ++word)
+		state->active[state->actives++] = word;
+}
+
+// intersect the candidates with a bitset of the shape (or with its
+// complement), only the words that still have candidates are touched
+void solver_and(solver_state *state, const unsigned long long *bits, bool complement)
+{
+	unsigned long long flip = complement ? ~0ULL : 0;
+	for (int index = 0; index < state->actives; ++index)
+		state->candidates[state->active[index]] &= bits[state->active[index]] ^ flip;
+}
+
+// forget the words that have no candidates left
+void solver_compact(solver_state *state)
+{
+	int kept = 0;
+	for (int index = 0; index < state->actives; ++index)
+		if (state->candidates[state->active[index]])
+			state->active[kept++] = state->active[index];
+	state->actives = kept;
+}
+
+// keep only the candidates that fit the characters shown and tried
+// since the last guess
+void solver_narrow(solver_state *state, const data *game)
+{
+	const shape *current = &state->index->shapes[state->shape];
+	int words = current->words;
+
+	// the members of a small shape are checked one by one
+	if (!current->contains)
+	{
+		for (int member = 0; member < current->count; ++member)
+		{
+			const entry *expression = &state->index->puzzle->entries[current->members[member]];
+			if (((state->candidates[0] >> member) & 1) &&
+				!solver_fits(state->index->puzzle->arena + expression->offset, game, current->length))
+				state->candidates[0] &= ~(1ULL << member);
+		}
+		solver_compact(state);
+		state->shown = game->shown;
+		state->tried = game->tried;
+		return;
+	}
+
+	// first the places where the new characters are shown: they leave
+	// few candidates, so the rest of the intersections are cheap
+	for (int ch = '!'; ch < CHARSET && state->actives; ++ch)
+	{
+		if (!charset_has(&game->shown, ch) || charset_has(&state->shown, ch))
+			continue;
+
+		int row = current->row[ch];
+		if (row == NO_ROW)
+			state->actives = 0;
+		// a shown _ can not be told from a hidden character
+		else if (ch == '_')
+			solver_and(state, current->contains + (size_t) row * words, false);
+		else
+			for (int position = 0; position < current->length; ++position)
+				if ((unsigned char) game->hidden[position] == charset_shown(ch))
+					solver_and(state, current->at + ((size_t) position * current->rows + row) * words, false);
+		solver_compact(state);
+	}
+
+	// then the places where they are not, and the mistakes
+	for (int ch = '!'; ch < CHARSET && state->actives; ++ch)
+	{
+		int row = current->row[ch];
+		if (row == NO_ROW)
+			continue;
+
+		if (charset_has(&game->tried, ch) && !charset_has(&state->tried, ch))
+			solver_and(state, current->contains + (size_t) row * words, true);
+		else if (ch != '_' && charset_has(&game->shown, ch) && !charset_has(&state->shown, ch))
+			for (int position = 0; position < current->length; ++position)
+				if (game->hidden[position] == '_')
+					solver_and(state, current->at + ((size_t) position * current->rows + row) * words, true);
+	}
+	solver_compact(state);
+
+	state->shown = game->shown;
+	state->tried = game->tried;
+}
+
+// if an expression fits the hidden string and the characters tried
+bool solver_fits(const char *string, const data *game, int length)
+{
+	for (int index = 0; index < length; ++index)
+	{
+		int ch = (unsigned char) string[index] % CHARSET;
+		if (charset_has(&game->tried, ch))
+			return false;
+		if (game->hidden[index] == '_' ? ch != '_' && charset_has(&game->shown, ch)
+			: (unsigned char) game->hidden[index] != charset_shown(ch))
+			return false;
+	}
+	return true;
+}
+
+// where every character is hidden in each candidate: one hash of the
+// positions for each row and candidate (0 if it is not there)
+void solver_patterns(solver_state *state, const data *game, int candidates)
+{
+	const shape *current = &state->index->shapes[state->shape];
+	const vector_string *puzzle = state->index->puzzle;
+	for (int row = 0; row < current->rows; ++row)
+		memset(state->patterns + (size_t) row * EXACT_SPLIT, 0, sizeof(unsigned long long) * candidates);
+
+	int count = 0;
+	for (int index = 0; index < state->actives; ++index)
+	{
+		int word = state->active[index];
+		for (unsigned long long bits = state->candidates[word]; bits; bits &= bits - 1)
+		{
+			int member = word * 64 + __builtin_ctzll(bits);
+			const char *string = puzzle->arena + puzzle->entries[current->members[member]].offset;
+			for (int position = 0; position < current->length; ++position)
+				if (game->hidden[position] == '_')
+				{
+					unsigned long long *pattern = &state->patterns[current->row[(unsigned char) string[position] % CHARSET] * EXACT_SPLIT + count];
+					*pattern = (*pattern ^ (position + 1)) * 0x100000001B3ULL;
+				}
+			count++;
+		}
+	}
+}
+
+// how the candidates are split by a character: the sum of n log n over
+// the groups of candidates that would see the same hidden string (the
+// smaller, the more is learned from the guess); found is set to the
+// candidates that have the character
+double solver_split(solver_state *state, int ch, int candidates, int *found)
+{
+	const shape *current = &state->index->shapes[state->shape];
+	int row = current->row[ch];
+	*found = 0;
+
+	// many candidates: only split by the ones that have the character
+	if (candidates > EXACT_SPLIT)
+	{
+		const unsigned long long *contains = current->contains + (size_t) row * current->words;
+		for (int index = 0; index < state->actives; ++index)
+			*found += __builtin_popcountll(state->candidates[state->active[index]] & contains[state->active[index]]);
+		int missing = candidates - *found;
+		return (*found ? *found * log2(*found) : 0) + (missing ? missing * log2(missing) : 0);
+	}
+
+	// few candidates: count the candidates of each pattern in a table
+	// (a new stamp empties it)
+	const unsigned long long *patterns = state->patterns + (size_t) row * EXACT_SPLIT;
+	int used[EXACT_SPLIT], groups = 0;
+	state->stamp++;
+	for (int index = 0; index < candidates; ++index)
+	{
+		*found += patterns[index] != 0;
+		int slot = patterns[index] & (2 * EXACT_SPLIT - 1);
+		while (state->groups[slot].stamp == state->stamp && state->groups[slot].pattern != patterns[index])
+			slot = (slot + 1) & (2 * EXACT_SPLIT - 1);
+		if (state->groups[slot].stamp != state->stamp)
+		{
+			state->groups[slot].stamp = state->stamp;
+			state->groups[slot].pattern = patterns[index];
+			state->groups[slot].count = 0;
+			used[groups++] = slot;
+		}
+		state->groups[slot].count++;
+	}
+
+	double split = 0;
+	for (int group = 0; group < groups; ++group)
+		if (state->groups[used[group]].count > 1)
+			split += state->groups[used[group]].count * log2(state->groups[used[group]].count);
+	return split;
+}
+
+// best character to try in the current match of game
+// returns -1 if no expression of the database fits the match
+int solver_guess(solver_state *state, const data *game)
+{
+	// a new match, or the same expression played again
+	bool subset = true;
+	for (int word = 0; word < CHARSET / 64; ++word)
+		subset &= !(state->shown.bits[word] & ~game->shown.bits[word]) &&
+			!(state->tried.bits[word] & ~game->tried.bits[word]);
+	if (state->match != game->index || !subset || state->shape < 0)
+		solver_restart(state, game);
+	if (state->shape < 0)
+		return -1;
+
+	solver_narrow(state, game);
+	int candidates = solver_candidates(state);
+	if (!candidates)
+		return -1;
+	if (candidates <= EXACT_SPLIT)
+		solver_patterns(state, game, candidates);
+
+	// the character that splits the candidates best, or that most of
+	// them have when two split them the same
+	const shape *current = &state->index->shapes[state->shape];
+	int best = -1, best_found = 0;
+	double best_split = 0;
+	for (int ch = '!'; ch < CHARSET; ++ch)
+	{
+		if (!charset_has(&current->letters, ch) || charset_has(&game->shown, ch) || charset_has(&game->tried, ch))
+			continue;
+
+		int found;
+		double split = solver_split(state, ch, candidates, &found);
+		if (best < 0 || split < best_split || (split == best_split && found > best_found))
+		{
+			best = ch;
+			best_split = split;
+			best_found = found;
+		}
+	}
+	return best;
+}
+
+// expressions that still fit the match after the last guess
+int solver_candidates(const solver_state *state)
+{
+	int candidates = 0;
+	for (int index = 0; index < state->actives; ++index)
+		candidates += __builtin_popcountll(state->candidates[state->active[index]]);
+	return candidates;
+}
@@ -0,0 +1,103 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "engine.h"
+
+// a player that only knows what the screen shows (the hidden string and
+// the characters tried) and guesses the character that splits best the
+// expressions of the database that still fit it
+//
+// the expressions are grouped by shape (length and places of the spaces),
+// that is all that is known of an expression when a match starts; a large
+// shape keeps a bitset of its expressions for every character and every
+// position, so each guess narrows the candidates with a few intersections
+
+// shapes with at most this many expressions have no bitsets, their
+// expressions are checked one by one
+#define SMALL_SHAPE 64
+// under this many candidates a guess is scored by the exact split of the
+// candidates, above it only by how many contain the character
+#define EXACT_SPLIT 256
+// row of a character that is not used by a shape
+#define NO_ROW 0xFF
+
+// expressions of the database with the same shape
+typedef struct shape
+{
+	// hash and length of the shape
+	unsigned long long key;
+	int length;
+	// expressions of the shape (indexes in the database)
+	int *members;
+	int count;
+	// words of 64 bits in a bitset of the members
+	int words;
+	// characters used by the members and their rows in the bitsets
+	charset letters;
+	unsigned char row[CHARSET];
+	int rows;
+	// (large shapes) members with a character anywhere: contains[row],
+	// and at a position: at[position][row]
+	unsigned long long *contains;
+	unsigned long long *at;
+} shape;
+
+// the shapes of a database, it is only read by the players, so every
+// thread can play with the same one
+typedef struct solver_index
+{
+	const vector_string *puzzle;
+	shape *shapes;
+	int count;
+	// open addressing table of the shapes by key (-1 for empty slots)
+	int *table;
+	int size;
+	// expressions in the shapes, in the order of the shapes
+	int *members;
+	// longest bitset of a shape, in words of 64 bits, and most
+	// characters used by a shape
+	int words;
+	int rows;
+} solver_index;
+
+// what a player knows of its current match
+typedef struct solver_state
+{
+	const solver_index *index;
+	// shape of the match (-1 if no expression fits it) and its members
+	// that still fit the hidden string
+	int shape;
+	unsigned long long *candidates;
+	// words of candidates that are not empty, the only ones that are
+	// intersected and counted
+	int *active;
+	int actives;
+	// the match and the characters the candidates were narrowed with
+	int match;
+	charset shown;
+	charset tried;
+	// (few candidates) where each character is hidden in each of them,
+	// patterns[row][candidate], and a table to count the same patterns
+	unsigned long long *patterns;
+	struct
+	{
+		unsigned long long pattern;
+		int count;
+		int stamp;
+	} groups[2 * EXACT_SPLIT];
+	int stamp;
+} solver_state;
+
+// the index is made once the database is loaded
+solver_index *solver_create(const vector_string *puzzle);
+void solver_destroy(solver_index *index);
+solver_state *solver_state_create(const solver_index *index);
+void solver_state_destroy(solver_state *state);
+
+// best character to try in the current match of game
+// returns -1 if no expression of the database fits the match
+int solver_guess(solver_state *state, const data *game);
+// expressions that still fit the match after the last guess
+int solver_candidates(const solver_state *state);
+
+#endif